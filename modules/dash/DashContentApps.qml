@@ -47,6 +47,7 @@ Item {
                         showHidden: false
                         query: searchBar.text
                         minScore: 0.6
+                        typoTolerance: 2
                         sort: true
                         sortReverse: false
                         sortProperty: "name"
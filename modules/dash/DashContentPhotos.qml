@@ -23,6 +23,7 @@ Item {
         }
 
         ScrollView {
+            id: scrollView
             Layout.fillWidth: true
             Layout.fillHeight: true
             contentWidth: availableWidth
@@ -46,7 +47,7 @@ Item {
                     headerInteractive: false
                     expanded: true
                     model: FileSystemModel {
-                        filter: FileSystemModel.Files
+                        filter: FileSystemModel.Images
                         path: "/home/" + Quickshell.env("USER") + "/Pictures"
                         recursive: true
                         query: searchBar.text
@@ -58,6 +59,8 @@ Item {
                         sortProperty: "name"
                     }
                     shelfItemSize: root.dashShelfItemSize
+                    viewportTop: scrollView.contentItem.contentY - y
+                    viewportHeight: scrollView.height
                 }
             }
         }
@@ -23,6 +23,7 @@ Item {
         }
 
         ScrollView {
+            id: scrollView
             Layout.fillWidth: true
             Layout.fillHeight: true
             contentWidth: availableWidth
@@ -46,8 +47,7 @@ Item {
                     headerInteractive: false
                     expanded: true
                     model: FileSystemModel {
-                        filter: FileSystemModel.Files
-                        nameFilters: ["*.mp4", "*.mkv", "*.mov", "*.avi"]
+                        filter: FileSystemModel.Videos
                         path: "/home/" + Quickshell.env("USER") + "/Videos"
                         recursive: true
                         query: searchBar.text
@@ -59,6 +59,8 @@ Item {
                         sortProperty: "name"
                     }
                     shelfItemSize: root.dashShelfItemSize
+                    viewportTop: scrollView.contentItem.contentY - y
+                    viewportHeight: scrollView.height
                 }
             }
         }
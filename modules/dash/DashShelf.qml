@@ -19,6 +19,26 @@ Item {
     property var headerSubText
     property var amount: expanded ? model.length : Math.floor(root.width / root.shelfItemSize)
 
+    // Part of the shelf scrolled into view, in the shelf's own coordinates.
+    // Only items in it load thumbnails; the screenful after it is prefetched.
+    property real viewportTop: 0
+    property real viewportHeight: height
+
+    readonly property int columns: Math.max(1, Math.floor(flowbox.width / root.shelfItemSize))
+    readonly property real rowHeight: root.shelfItemSize - 6
+    readonly property int firstVisible: Math.max(0, Math.floor((viewportTop - flowbox.y) / rowHeight)) * columns
+    readonly property int visibleCount: (Math.ceil(viewportHeight / rowHeight) + 1) * columns
+
+    function prefetchNext() {
+        if(model && typeof model.prefetch === "function") {
+            model.prefetch(firstVisible + visibleCount, visibleCount, shelfItemSize);
+        }
+    }
+
+    onFirstVisibleChanged: prefetchNext()
+    onVisibleCountChanged: prefetchNext()
+    onAmountChanged: prefetchNext()
+
     Component.onCompleted: {
         if(headerInteractive) {
             if(expanded) {
@@ -80,8 +100,10 @@ Item {
             model: root.model
 
             DashShelfItem {
+                required property int index
                 size: shelfItemSize
                 spacing: 1
+                inView: index >= root.firstVisible && index < root.firstVisible + root.visibleCount
             }
         }
     }
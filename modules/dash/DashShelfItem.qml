@@ -8,6 +8,10 @@ Item {
     required property var modelData
     required property var spacing
 
+    // Off-screen items don't load their thumbnail; scrolling one away
+    // cancels its request
+    property bool inView: true
+
     implicitWidth: size * spacing
     implicitHeight: size - 6
 
@@ -27,6 +31,8 @@ Item {
         onClicked: {
             if(modelData.isDesktopEntry) {
                 modelData.execute();
+            } else if(modelData.open) {
+                modelData.open();
             } else {
                 Quickshell.execDetached({
                     command: ["xdg-open", modelData.path],
@@ -115,24 +121,33 @@ Item {
         return fallback[type] || "unknown";
     }
 
+    // Generated off-thread; the icon below stays up until it is ready
+    readonly property string thumbnailSource: {
+        if(modelData.isImage) {
+            return modelData.imageThumbnail;
+        }
+
+        if(modelData.isVideo) {
+            return modelData.videoThumbnail;
+        }
+
+        if(modelData.isMusic) {
+            return modelData.musicThumbnail;
+        }
+
+        return "";
+    }
+
     Image {
         id: icon
         anchors.fill: selectionBox
         anchors.margins: 12
+        visible: thumbnail.status !== Image.Ready
         source: {
-            if(modelData.isImage) {
-                return modelData.imageThumbnail;
-            }
-
-            if(modelData.isVideo) {
-                return "file://" + modelData.videoThumbnail;
-            }
-
-            if(modelData.isMusic) {
-                return "file://" + modelData.musicThumbnail;
-            }
-
             if(modelData.isDesktopEntry) {
+                if(modelData.iconPath) {
+                    return "file://" + modelData.iconPath;
+                }
                 return Quickshell.iconPath(modelData.icon);
             }
 
@@ -143,6 +158,18 @@ Item {
             return Quickshell.iconPath(mimeToIcon(modelData.mimeType))
         }
         fillMode: Image.PreserveAspectFit
+        asynchronous: true
+        sourceSize.width: selectionBox.width
+        sourceSize.height: selectionBox.height
+    }
+
+    Image {
+        id: thumbnail
+        anchors.fill: selectionBox
+        anchors.margins: 12
+        visible: status === Image.Ready
+        source: root.inView ? root.thumbnailSource : ""
+        fillMode: Image.PreserveAspectFit
         cache: false
         asynchronous: true
         sourceSize.width: selectionBox.width
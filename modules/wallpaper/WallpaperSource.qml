@@ -1,6 +1,7 @@
 import QtQuick
 import Quickshell
 import qs
+import QuickSearch
 
 ShaderEffectSource {
     required property size resolution
@@ -13,7 +14,15 @@ ShaderEffectSource {
             id: wallpaperBack
             anchors.fill: parent
             fillMode: Image.PreserveAspectCrop
-            source: Config.wallpaper
+            source: wallpaperCache.cachePath
+
+            // Decoded once at the screen's size rather than at full resolution
+            CachingImageManager {
+                id: wallpaperCache
+                item: wallpaperBack
+                cacheDir: "file://" + Quickshell.env("HOME") + "/.cache/unite/wallpapers"
+                path: Config.wallpaper.replace(/^file:\/\//, "")
+            }
         }
 
         Image {
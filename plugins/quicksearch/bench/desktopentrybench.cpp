@@ -0,0 +1,189 @@
+// Times the desktop entry parser against the QSettings-based one it replaced.
+//
+//   cmake -B build -DQUICKSEARCH_BUILD_BENCH=ON && cmake --build build
+//   build/desktopentrybench [rounds] [dir...]
+//
+// Parses every .desktop file below the given directories (default: the XDG
+// application directories) with both parsers and prints the time of the
+// first pass and the median of the rest. Files are read once beforehand so
+// both start from the page cache. QSettings keeps recently used files in a
+// process-wide cache of its own, which the later legacy rounds may hit; the
+// first pass is the one that matches startup.
+
+#include "../models/desktopentry.hpp"
+
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QLocale>
+#include <QSettings>
+#include <QTextStream>
+#include <algorithm>
+#include <optional>
+
+using quicksearch::models::DesktopActionSpec;
+using quicksearch::models::DesktopEntryData;
+using quicksearch::models::DesktopEntryParser;
+
+namespace {
+
+    // The parser as it was before the single-pass scanner, minus the
+    // DesktopAction QObject it created per action
+    QString legacyLocalizedKey(QSettings& settings, const QString& key) {
+        const QString locale = QLocale::system().name();
+        const QString lang = locale.split('_').first();
+
+        QString value = settings.value(key + "[" + locale + "]").toString();
+        if (!value.isEmpty()) {
+            return value;
+        }
+
+        value = settings.value(key + "[" + lang + "]").toString();
+        if (!value.isEmpty()) {
+            return value;
+        }
+
+        return settings.value(key).toString();
+    }
+
+    std::optional<DesktopEntryData> legacyParse(const QString& filePath) {
+        QSettings settings(filePath, QSettings::IniFormat);
+
+        settings.beginGroup("Desktop Entry");
+        if (settings.value("Type").toString() != "Application") {
+            settings.endGroup();
+            return std::nullopt;
+        }
+
+        DesktopEntryData data;
+        data.name = legacyLocalizedKey(settings, "Name");
+        data.genericName = legacyLocalizedKey(settings, "GenericName");
+        data.comment = legacyLocalizedKey(settings, "Comment");
+        data.icon = settings.value("Icon").toString();
+        data.execString = settings.value("Exec").toString();
+        DesktopEntryParser::parseExecString(data.execString);
+        data.categories = settings.value("Categories").toString().split(';', Qt::SkipEmptyParts);
+        data.keywords = legacyLocalizedKey(settings, "Keywords").split(';', Qt::SkipEmptyParts);
+        data.noDisplay = settings.value("NoDisplay", false).toBool();
+        data.runInTerminal = settings.value("Terminal", false).toBool();
+        data.workingDirectory = settings.value("Path").toString();
+        data.startupClass = settings.value("StartupWMClass").toString();
+        data.id = QFileInfo(filePath).fileName();
+        settings.endGroup();
+
+        settings.beginGroup("Desktop Entry");
+        const QStringList actionIds = settings.value("Actions").toString().split(';', Qt::SkipEmptyParts);
+        settings.endGroup();
+
+        for (const QString& actionId : actionIds) {
+            const QString groupName = "Desktop Action " + actionId;
+            if (settings.childGroups().contains(groupName)) {
+                settings.beginGroup(groupName);
+                DesktopActionSpec action;
+                action.id = actionId;
+                action.name = legacyLocalizedKey(settings, "Name");
+                action.exec = settings.value("Exec").toString();
+                action.icon = settings.value("Icon").toString();
+                DesktopEntryParser::parseExecString(action.exec);
+                data.actions.append(action);
+                settings.endGroup();
+            }
+        }
+
+        return data;
+    }
+
+    struct Timing {
+        qint64 firstNs = 0;
+        qint64 medianNs = 0;
+        int parsed = 0;
+    };
+
+    Timing run(const QStringList& files, int rounds, std::optional<DesktopEntryData> (*parse)(const QString&)) {
+        Timing timing;
+        QList<qint64> later;
+
+        for (int round = 0; round < rounds; ++round) {
+            int parsed = 0;
+            QElapsedTimer timer;
+            timer.start();
+            for (const QString& file : files) {
+                if (parse(file)) {
+                    ++parsed;
+                }
+            }
+            const qint64 elapsed = timer.nsecsElapsed();
+
+            if (round == 0) {
+                timing.firstNs = elapsed;
+                timing.parsed = parsed;
+            } else {
+                later.append(elapsed);
+            }
+        }
+
+        if (!later.isEmpty()) {
+            std::sort(later.begin(), later.end());
+            timing.medianNs = later.at(later.size() / 2);
+        }
+        return timing;
+    }
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QStringList args = app.arguments().mid(1);
+    bool isNumber = false;
+    const int rounds = args.isEmpty() ? 0 : args.first().toInt(&isNumber);
+    if (isNumber) {
+        args.removeFirst();
+    }
+    const QStringList dirs = args.isEmpty() ? DesktopEntryParser::resolveXdgDataDirs() : args;
+
+    QStringList files;
+    for (const QString& dir : dirs) {
+        QDirIterator it(dir, { "*.desktop" }, QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            files.append(it.next());
+        }
+    }
+    if (files.isEmpty()) {
+        out << "No .desktop files in " << dirs.join(", ") << Qt::endl;
+        return 1;
+    }
+
+    // Same starting point for both: contents in the page cache
+    for (const QString& file : std::as_const(files)) {
+        QFile f(file);
+        if (f.open(QIODevice::ReadOnly)) {
+            f.readAll();
+        }
+    }
+
+    const int passes = isNumber && rounds > 0 ? rounds : 5;
+    const Timing legacy = run(files, passes, &legacyParse);
+    const Timing scanner = run(files, passes, &DesktopEntryParser::parse);
+
+    const auto ms = [](qint64 ns) {
+        return QString::number(double(ns) / 1e6, 'f', 2);
+    };
+
+    out << files.size() << " files in " << dirs.join(", ") << ", " << passes << " passes" << Qt::endl;
+    out << "QSettings: first " << ms(legacy.firstNs) << " ms, median " << ms(legacy.medianNs) << " ms, "
+        << legacy.parsed << " applications" << Qt::endl;
+    out << "scanner:   first " << ms(scanner.firstNs) << " ms, median " << ms(scanner.medianNs) << " ms, "
+        << scanner.parsed << " applications" << Qt::endl;
+    if (scanner.firstNs > 0) {
+        out << "first pass " << QString::number(double(legacy.firstNs) / double(scanner.firstNs), 'f', 1)
+            << "x faster" << Qt::endl;
+    }
+    if (legacy.parsed != scanner.parsed) {
+        out << "(the scanner skips Hidden=true entries, which QSettings parsed)" << Qt::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,455 @@
+#include "albumart.hpp"
+
+#include <QFile>
+#include <QtEndian>
+#include <cstring>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        // Tags larger than this are broken or hostile; art is never this big
+        constexpr qint64 MaxBlock = 32LL * 1024 * 1024;
+
+        // Picture type of a front cover, in ID3v2 and FLAC alike
+        constexpr int FrontCover = 3;
+
+        // Keeps the first picture seen, replaced only by a front cover
+        struct Pick {
+            QByteArray data;
+            bool front = false;
+
+            void offer(const QByteArray& picture, int type) {
+                if (picture.isEmpty() || front) {
+                    return;
+                }
+                if (data.isEmpty() || type == FrontCover) {
+                    data = picture;
+                    front = type == FrontCover;
+                }
+            }
+        };
+
+        quint32 syncsafe(const uchar* data) {
+            return (quint32(data[0] & 0x7f) << 21) | (quint32(data[1] & 0x7f) << 14) |
+                   (quint32(data[2] & 0x7f) << 7) | quint32(data[3] & 0x7f);
+        }
+
+        // Undoes ID3v2 unsynchronisation: FF 00 becomes FF
+        QByteArray resynchronized(const QByteArray& data) {
+            QByteArray out;
+            out.reserve(data.size());
+            for (qsizetype i = 0; i < data.size(); ++i) {
+                out.append(data.at(i));
+                if (uchar(data.at(i)) == 0xff && i + 1 < data.size() && data.at(i + 1) == 0) {
+                    ++i;
+                }
+            }
+            return out;
+        }
+
+        // Offset just past a string in the given ID3v2 text encoding
+        qsizetype skipString(const QByteArray& data, qsizetype pos, uchar encoding) {
+            if (encoding == 1 || encoding == 2) {
+                // UTF-16: a double NUL on a character boundary
+                for (; pos + 1 < data.size(); pos += 2) {
+                    if (data.at(pos) == 0 && data.at(pos + 1) == 0) {
+                        return pos + 2;
+                    }
+                }
+                return -1;
+            }
+            const qsizetype end = data.indexOf('\0', pos);
+            return end < 0 ? -1 : end + 1;
+        }
+
+        // APIC (v2.3/v2.4): encoding, MIME type, picture type, description, data
+        // PIC (v2.2): encoding, three-letter format, picture type, description, data
+        void parsePictureFrame(const QByteArray& frame, bool v22, Pick* pick) {
+            if (frame.size() < 4) {
+                return;
+            }
+            const uchar encoding = uchar(frame.at(0));
+
+            qsizetype pos = 1;
+            if (v22) {
+                pos += 3;
+            } else {
+                pos = skipString(frame, pos, 0);
+            }
+            if (pos < 0 || pos >= frame.size()) {
+                return;
+            }
+
+            const int type = uchar(frame.at(pos));
+            pos = skipString(frame, pos + 1, encoding);
+            if (pos < 0) {
+                return;
+            }
+
+            pick->offer(frame.mid(pos), type);
+        }
+
+        // Reads the ID3v2 tag at the file's current position, which must be
+        // its "ID3" header. Leaves the file positioned after the tag.
+        bool readId3v2(QFile& file, Pick* pick) {
+            const QByteArray header = file.read(10);
+            if (header.size() < 10 || !header.startsWith("ID3")) {
+                return false;
+            }
+            const auto* head = reinterpret_cast<const uchar*>(header.constData());
+            const int version = head[3];
+            const uchar flags = head[5];
+            const quint32 size = syncsafe(head + 6);
+            if (version < 2 || version > 4 || size > MaxBlock) {
+                return false;
+            }
+
+            QByteArray tag = file.read(size);
+            if (flags & 0x10) {
+                file.skip(10); // footer
+            }
+
+            // Before v2.4 the whole tag is unsynchronised; from v2.4 per frame
+            if ((flags & 0x80) && version < 4) {
+                tag = resynchronized(tag);
+            }
+
+            qsizetype pos = 0;
+            if ((flags & 0x40) && version >= 3 && tag.size() >= 4) {
+                const auto* ext = reinterpret_cast<const uchar*>(tag.constData());
+                pos = version == 3 ? 4 + qsizetype(qFromBigEndian<quint32>(ext)) : qsizetype(syncsafe(ext));
+            }
+
+            const bool v22 = version == 2;
+            const qsizetype headerSize = v22 ? 6 : 10;
+            while (pos + headerSize <= tag.size()) {
+                const auto* frame = reinterpret_cast<const uchar*>(tag.constData() + pos);
+                if (frame[0] == 0) {
+                    break; // padding
+                }
+
+                qsizetype frameSize = 0;
+                quint16 frameFlags = 0;
+                if (v22) {
+                    frameSize = (qsizetype(frame[3]) << 16) | (qsizetype(frame[4]) << 8) | frame[5];
+                } else {
+                    frameSize = version == 4 ? qsizetype(syncsafe(frame + 4)) : qsizetype(qFromBigEndian<quint32>(frame + 4));
+                    frameFlags = qFromBigEndian<quint16>(frame + 8);
+                }
+                if (frameSize <= 0 || pos + headerSize + frameSize > tag.size()) {
+                    break;
+                }
+
+                const bool isPicture = v22 ? std::memcmp(frame, "PIC", 3) == 0 : std::memcmp(frame, "APIC", 4) == 0;
+                if (isPicture) {
+                    QByteArray body = tag.mid(pos + headerSize, frameSize);
+
+                    // Compressed or encrypted frames aren't worth supporting
+                    const bool packed = version == 4 ? (frameFlags & 0x000c) : (frameFlags & 0x00c0);
+                    if (!packed) {
+                        if (frameFlags & (version == 4 ? 0x0040 : 0x0020)) {
+                            body.remove(0, 1); // group identifier
+                        }
+                        if (version == 4 && (frameFlags & 0x0001)) {
+                            body.remove(0, 4); // data length indicator
+                        }
+                        if (version == 4 && (frameFlags & 0x0002)) {
+                            body = resynchronized(body);
+                        }
+                        parsePictureFrame(body, v22, pick);
+                    }
+                }
+
+                pos += headerSize + frameSize;
+            }
+            return true;
+        }
+
+        // A FLAC PICTURE block body, also the payload of METADATA_BLOCK_PICTURE
+        void parseFlacPicture(const QByteArray& block, Pick* pick) {
+            const auto* data = reinterpret_cast<const uchar*>(block.constData());
+            const qsizetype length = block.size();
+
+            // Type, then the MIME type and description, each length-prefixed
+            qsizetype pos = 0;
+            if (length < 8) {
+                return;
+            }
+            const int type = int(qFromBigEndian<quint32>(data));
+            pos += 4;
+            for (int i = 0; i < 2; ++i) {
+                if (pos + 4 > length) {
+                    return;
+                }
+                pos += 4 + qsizetype(qFromBigEndian<quint32>(data + pos));
+            }
+
+            // Width, height, depth, colors, then the data length
+            pos += 16;
+            if (pos + 4 > length) {
+                return;
+            }
+            const qsizetype size = qFromBigEndian<quint32>(data + pos);
+            pos += 4;
+            if (size > length - pos) {
+                return;
+            }
+
+            pick->offer(block.mid(pos, size), type);
+        }
+
+        // Walks the metadata blocks after the "fLaC" marker, reading only
+        // PICTURE blocks and seeking over the rest
+        void readFlac(QFile& file, Pick* pick) {
+            for (;;) {
+                const QByteArray header = file.read(4);
+                if (header.size() < 4) {
+                    return;
+                }
+                const auto* head = reinterpret_cast<const uchar*>(header.constData());
+                const bool last = head[0] & 0x80;
+                const int type = head[0] & 0x7f;
+                const qint64 size = (qint64(head[1]) << 16) | (qint64(head[2]) << 8) | head[3];
+
+                if (type == 6) {
+                    parseFlacPicture(file.read(size), pick);
+                    if (pick->front) {
+                        return;
+                    }
+                } else if (!file.seek(file.pos() + size)) {
+                    return;
+                }
+
+                if (last || type == 127) {
+                    return;
+                }
+            }
+        }
+
+        // Reassembles the second packet of the first logical Ogg stream,
+        // which holds the Vorbis or Opus comments
+        QByteArray oggCommentPacket(QFile& file) {
+            QByteArray packet;
+            int packetIndex = 0;
+            quint32 serial = 0;
+            bool first = true;
+
+            for (;;) {
+                const QByteArray header = file.read(27);
+                if (header.size() < 27 || !header.startsWith("OggS")) {
+                    return QByteArray();
+                }
+                const auto* head = reinterpret_cast<const uchar*>(header.constData());
+                const quint32 pageSerial = qFromLittleEndian<quint32>(head + 14);
+                const QByteArray lacing = file.read(head[26]);
+                if (lacing.size() < head[26]) {
+                    return QByteArray();
+                }
+
+                if (first) {
+                    serial = pageSerial;
+                    first = false;
+                }
+
+                // Pages of other multiplexed streams are skipped whole
+                if (pageSerial != serial) {
+                    qint64 skip = 0;
+                    for (const char segment : lacing) {
+                        skip += uchar(segment);
+                    }
+                    if (!file.seek(file.pos() + skip)) {
+                        return QByteArray();
+                    }
+                    continue;
+                }
+
+                for (const char segment : lacing) {
+                    const int segmentSize = uchar(segment);
+                    if (packetIndex == 1) {
+                        packet += file.read(segmentSize);
+                        if (packet.size() > MaxBlock) {
+                            return QByteArray();
+                        }
+                    } else if (!file.seek(file.pos() + segmentSize)) {
+                        return QByteArray();
+                    }
+
+                    // A segment shorter than 255 bytes ends the packet
+                    if (segmentSize < 255) {
+                        if (packetIndex == 1) {
+                            return packet;
+                        }
+                        ++packetIndex;
+                    }
+                }
+            }
+        }
+
+        // Vorbis comments: vendor string, then "KEY=value" strings, all
+        // with 32-bit little-endian lengths
+        void parseVorbisComments(const QByteArray& comments, Pick* pick) {
+            const auto* data = reinterpret_cast<const uchar*>(comments.constData());
+            const qsizetype length = comments.size();
+
+            if (length < 8) {
+                return;
+            }
+            qsizetype pos = 4 + qsizetype(qFromLittleEndian<quint32>(data));
+            if (pos + 4 > length) {
+                return;
+            }
+            const quint32 count = qFromLittleEndian<quint32>(data + pos);
+            pos += 4;
+
+            static const QByteArray PictureKey = "METADATA_BLOCK_PICTURE=";
+            static const QByteArray CoverArtKey = "COVERART="; // older, raw image only
+
+            for (quint32 i = 0; i < count && pos + 4 <= length; ++i) {
+                const qsizetype size = qFromLittleEndian<quint32>(data + pos);
+                pos += 4;
+                if (size > length - pos) {
+                    return;
+                }
+
+                const QByteArray comment = QByteArray::fromRawData(comments.constData() + pos, size);
+                const qsizetype equals = comment.indexOf('=');
+                if (equals > 0) {
+                    const QByteArray key = comment.left(equals + 1).toUpper();
+                    if (key == PictureKey) {
+                        parseFlacPicture(QByteArray::fromBase64(comment.mid(equals + 1)), pick);
+                    } else if (key == CoverArtKey) {
+                        pick->offer(QByteArray::fromBase64(comment.mid(equals + 1)), FrontCover);
+                    }
+                    if (pick->front) {
+                        return;
+                    }
+                }
+                pos += size;
+            }
+        }
+
+        // False for Ogg streams other than Vorbis and Opus, e.g. Ogg FLAC
+        bool readOgg(QFile& file, Pick* pick) {
+            static const QByteArray VorbisComments("\x03" "vorbis");
+            static const QByteArray OpusComments("OpusTags");
+
+            const QByteArray packet = oggCommentPacket(file);
+            if (packet.startsWith(VorbisComments)) {
+                parseVorbisComments(packet.mid(VorbisComments.size()), pick);
+            } else if (packet.startsWith(OpusComments)) {
+                parseVorbisComments(packet.mid(OpusComments.size()), pick);
+            } else {
+                return false;
+            }
+            return true;
+        }
+
+        // Finds the child box of the given type between pos and end, setting
+        // pos and end to its payload. Handles 64-bit and to-end-of-file sizes.
+        bool findBox(QFile& file, const char* type, qint64* pos, qint64* end) {
+            qint64 at = *pos;
+            while (at + 8 <= *end) {
+                if (!file.seek(at)) {
+                    return false;
+                }
+                const QByteArray header = file.read(16);
+                if (header.size() < 8) {
+                    return false;
+                }
+                const auto* head = reinterpret_cast<const uchar*>(header.constData());
+
+                qint64 size = qFromBigEndian<quint32>(head);
+                qint64 headerSize = 8;
+                if (size == 1 && header.size() == 16) {
+                    size = qint64(qFromBigEndian<quint64>(head + 8));
+                    headerSize = 16;
+                } else if (size == 0) {
+                    size = *end - at;
+                }
+                if (size < headerSize || at + size > *end) {
+                    return false;
+                }
+
+                if (std::memcmp(head + 4, type, 4) == 0) {
+                    *pos = at + headerSize;
+                    *end = at + size;
+                    return true;
+                }
+                at += size;
+            }
+            return false;
+        }
+
+        // moov/udta/meta/ilst/covr/data; only the boxes on that path are read
+        void readMp4(QFile& file, Pick* pick) {
+            qint64 pos = 0;
+            qint64 end = file.size();
+
+            for (const char* type : { "moov", "udta", "meta" }) {
+                if (!findBox(file, type, &pos, &end)) {
+                    return;
+                }
+            }
+            pos += 4; // meta is a full box: version and flags
+
+            for (const char* type : { "ilst", "covr", "data" }) {
+                if (!findBox(file, type, &pos, &end)) {
+                    return;
+                }
+            }
+
+            // The first data box is the cover; 8 bytes of type and locale precede the image
+            const qint64 size = end - pos - 8;
+            if (size > 0 && size <= MaxBlock && file.seek(pos + 8)) {
+                pick->offer(file.read(size), FrontCover);
+            }
+        }
+
+    } // namespace
+
+    AlbumArt::Result AlbumArt::read(const QString& path, QByteArray* picture) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return Result::Unsupported;
+        }
+
+        const QByteArray magic = file.peek(12);
+        if (magic.size() < 12) {
+            return Result::Unsupported;
+        }
+
+        Pick pick;
+        if (magic.startsWith("ID3")) {
+            if (!readId3v2(file, &pick)) {
+                return Result::Unsupported;
+            }
+            // Some encoders put an ID3 tag in front of FLAC
+            if (!pick.front && file.peek(4) == "fLaC") {
+                file.skip(4);
+                readFlac(file, &pick);
+            }
+        } else if (magic.startsWith("fLaC")) {
+            file.skip(4);
+            readFlac(file, &pick);
+        } else if (magic.startsWith("OggS")) {
+            if (!readOgg(file, &pick)) {
+                return Result::Unsupported;
+            }
+        } else if (magic.mid(4, 4) == "ftyp") {
+            readMp4(file, &pick);
+        } else if (uchar(magic.at(0)) == 0xff && (uchar(magic.at(1)) & 0xe0) == 0xe0) {
+            // MPEG audio without an ID3v2 tag has nowhere to keep a picture
+            return Result::None;
+        } else {
+            return Result::Unsupported;
+        }
+
+        if (pick.data.isEmpty()) {
+            return Result::None;
+        }
+        *picture = pick.data;
+        return Result::Found;
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+namespace quicksearch::models {
+
+    // Reads the cover picture embedded in a music file's tags, in-process.
+    //
+    // Only the tag blocks are read, by seeking past everything else: ID3v2
+    // APIC/PIC frames (MP3, and ID3 in front of FLAC), FLAC PICTURE blocks,
+    // METADATA_BLOCK_PICTURE comments in Ogg Vorbis and Opus, and the covr
+    // item of MP4/M4A files. The picture is returned still encoded (usually
+    // JPEG or PNG) so the caller can decode it at the size it needs. A front
+    // cover is preferred over other pictures.
+    //
+    // Blocks; called from the thumbnail workers only.
+    class AlbumArt {
+    public:
+        enum class Result {
+            Found,      // picture holds the encoded image
+            None,       // the tags were read and have no picture
+            Unsupported // not a container we parse; ask something else
+        };
+
+        static Result read(const QString& path, QByteArray* picture);
+    };
+
+} // namespace quicksearch::models
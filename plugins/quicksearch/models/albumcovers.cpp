@@ -0,0 +1,228 @@
+#include "albumcovers.hpp"
+#include "albumart.hpp"
+#include "thumbnailcache.hpp"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QImage>
+#include <QImageReader>
+#include <QMutex>
+#include <QProcess>
+#include <QSaveFile>
+#include <QSet>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QWaitCondition>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        constexpr int CoverQuality = 85;
+
+        // Folder image names, most specific first; AlbumArt* matches
+        // Windows Media Player's AlbumArt_{GUID}_Large.jpg and friends
+        const QStringList CoverNames = { "cover", "folder", "front" };
+        const QString AlbumArtPrefix = QStringLiteral("albumart");
+        const QStringList CoverSuffixes = { "jpg", "jpeg", "png", "webp", "gif", "bmp" };
+
+        struct DirectoryCover {
+            qint64 mtime = 0; // of the directory, ms
+            QString cover;
+        };
+
+        QMutex directoriesMutex;
+        QHash<QString, DirectoryCover> directories;
+
+        // Covers being made right now, by file name
+        QMutex pendingMutex;
+        QWaitCondition pendingDone;
+        QSet<QString> pending;
+
+        QString coversDir() {
+            return QDir::homePath() + "/.cache/unite/album-covers";
+        }
+
+        // Lower is better; -1 if the file isn't a folder image
+        int coverRank(const QFileInfo& info) {
+            if (!CoverSuffixes.contains(info.suffix().toLower())) {
+                return -1;
+            }
+
+            const QString base = info.completeBaseName().toLower();
+            const qsizetype index = CoverNames.indexOf(base);
+            if (index >= 0) {
+                return int(index);
+            }
+            if (base.startsWith(AlbumArtPrefix)) {
+                return base.endsWith("large") ? int(CoverNames.size()) : int(CoverNames.size()) + 1;
+            }
+            return -1;
+        }
+
+        QImage decodeScaled(const QByteArray& data, int size) {
+            QByteArray bytes = data;
+            QBuffer buffer(&bytes);
+            QImageReader reader(&buffer);
+            reader.setAutoTransform(true);
+
+            const QSize imageSize = reader.size();
+            if (imageSize.isValid() && (imageSize.width() > size || imageSize.height() > size)) {
+                reader.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+            }
+
+            const QImage image = reader.read();
+            if (image.width() > size || image.height() > size) {
+                return image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            }
+            return image;
+        }
+
+    } // namespace
+
+    QString AlbumCovers::thumbnail(const QString& path, int size, const std::function<bool()>& isCanceled) {
+        const QByteArray art = embedded(path, isCanceled);
+        if (isCanceled && isCanceled()) {
+            return QString();
+        }
+
+        // Identical art in every track of an album hashes the same
+        if (!art.isEmpty()) {
+            const QByteArray key = QCryptographicHash::hash(art, QCryptographicHash::Sha1).toHex();
+            const QString file = shared(key, size, [&art]() {
+                return art;
+            });
+            if (!file.isEmpty()) {
+                return file;
+            }
+        }
+
+        const QString cover = folderCover(QFileInfo(path).absolutePath());
+        if (cover.isEmpty()) {
+            return QString();
+        }
+
+        const QFileInfo coverInfo(cover);
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(cover.toUtf8());
+        hash.addData(QByteArray::number(coverInfo.lastModified().toMSecsSinceEpoch()));
+        return shared(hash.result().toHex(), size, [&cover]() {
+            QFile file(cover);
+            return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+        });
+    }
+
+    QString AlbumCovers::folderCover(const QString& dir) {
+        const qint64 mtime = QFileInfo(dir).lastModified().toMSecsSinceEpoch();
+        {
+            QMutexLocker locker(&directoriesMutex);
+            const auto it = directories.constFind(dir);
+            if (it != directories.cend() && it->mtime == mtime) {
+                return it->cover;
+            }
+        }
+
+        // One listing instead of probing every spelling
+        QString best;
+        int bestRank = -1;
+        const QFileInfoList entries = QDir(dir).entryInfoList(QDir::Files | QDir::Readable);
+        for (const QFileInfo& entry : entries) {
+            const int rank = coverRank(entry);
+            if (rank >= 0 && (bestRank < 0 || rank < bestRank)) {
+                best = entry.absoluteFilePath();
+                bestRank = rank;
+            }
+        }
+
+        QMutexLocker locker(&directoriesMutex);
+        directories.insert(dir, DirectoryCover { mtime, best });
+        return best;
+    }
+
+    QByteArray AlbumCovers::embedded(const QString& path, const std::function<bool()>& isCanceled) {
+        QByteArray picture;
+        switch (AlbumArt::read(path, &picture)) {
+        case AlbumArt::Result::Found:
+            return picture;
+        case AlbumArt::Result::None:
+            return QByteArray();
+        case AlbumArt::Result::Unsupported:
+            break;
+        }
+
+        if (isCanceled && isCanceled()) {
+            return QByteArray();
+        }
+
+        // Containers the tag reader doesn't know are left to ffmpeg
+        const QTemporaryDir tempDir;
+        if (!tempDir.isValid()) {
+            return QByteArray();
+        }
+        const QString artPath = tempDir.filePath("cover.jpg");
+
+        QProcess ffmpeg;
+        ffmpeg.start("ffmpeg", QStringList()
+            << "-i" << path
+            << "-an"  // Disable audio
+            << "-vcodec" << "copy"  // Copy video stream (album art)
+            << artPath
+            << "-y");
+
+        if (!ffmpeg.waitForFinished(5000) || ffmpeg.exitCode() != 0) {
+            return QByteArray();
+        }
+
+        QFile art(artPath);
+        return art.open(QIODevice::ReadOnly) ? art.readAll() : QByteArray();
+    }
+
+    QString AlbumCovers::shared(const QByteArray& key, int size, const std::function<QByteArray()>& source) {
+        const QString base = coversDir() + '/' + QString::fromLatin1(key) + '-' + QString::number(size);
+        ThumbnailCache* cache = ThumbnailCache::instance();
+
+        QMutexLocker locker(&pendingMutex);
+        while (pending.contains(base)) {
+            pendingDone.wait(&pendingMutex);
+        }
+
+        // Indexed under its own name; finding it also marks it used
+        for (const char* suffix : { ".jpg", ".png" }) {
+            QString file;
+            if (cache->find(Thumbnailer::Kind::Music, base + suffix, 0, size, &file) ==
+                    ThumbnailCache::Status::Found &&
+                QFileInfo::exists(file)) {
+                return file;
+            }
+        }
+
+        pending.insert(base);
+        locker.unlock();
+
+        QString file;
+        const QImage image = decodeScaled(source(), size);
+        if (!image.isNull()) {
+            QDir().mkpath(coversDir());
+
+            const bool alpha = image.hasAlphaChannel();
+            const QString candidate = base + (alpha ? ".png" : ".jpg");
+            QSaveFile out(candidate);
+            if (out.open(QIODevice::WriteOnly) && image.save(&out, alpha ? "PNG" : "JPEG", alpha ? -1 : CoverQuality) &&
+                out.commit()) {
+                cache->insert(Thumbnailer::Kind::Music, candidate, 0, size, candidate, true);
+                file = candidate;
+            }
+        }
+
+        locker.relock();
+        pending.remove(base);
+        pendingDone.wakeAll();
+        return file;
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+namespace quicksearch::models {
+
+    // Album covers, thumbnailed once and shared by every track showing them.
+    //
+    // A track's cover is the art embedded in it (see AlbumArt; ffmpeg for
+    // other containers) or else an image next to it: cover.*, folder.*,
+    // front.* or AlbumArt*. Embedded art is keyed by a hash of its bytes, so
+    // fifteen tracks carrying the same picture share one thumbnail; a folder
+    // image is keyed by its path and mtime. Thumbnails go to
+    // ~/.cache/unite/album-covers/<key>-<size>.{jpg,png} and are indexed in
+    // ThumbnailCache under their own name, so they count against its budget.
+    //
+    // Each directory's folder image is found with one listing and remembered
+    // until the directory's mtime changes. Workers wanting a cover another
+    // worker is already making wait for it instead of decoding it again.
+    //
+    // Blocks; called from the thumbnail workers only.
+    class AlbumCovers {
+    public:
+        // Shared thumbnail of at most size pixels for the track's cover,
+        // making it if needed. Empty if the track has no cover or
+        // isCanceled() returned true.
+        static QString thumbnail(const QString& path, int size, const std::function<bool()>& isCanceled);
+
+        // Image in dir standing for its album, or empty
+        static QString folderCover(const QString& dir);
+
+    private:
+        // Encoded art embedded in the track, or empty
+        static QByteArray embedded(const QString& path, const std::function<bool()>& isCanceled);
+
+        // Finds or makes <key>-<size>; source() gives the encoded cover
+        static QString shared(const QByteArray& key, int size, const std::function<QByteArray()>& source);
+    };
+
+} // namespace quicksearch::models
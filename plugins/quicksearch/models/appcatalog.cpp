@@ -0,0 +1,571 @@
+#include "appcatalog.hpp"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <cstring>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        // On-disk catalog, native endian (it never leaves this machine):
+        //
+        //   Header | DirRecord[dirCount] | FileRecord[fileCount] |
+        //   ActionRecord[actionCount] | UTF-16 string pool[poolLength]
+        //
+        // Strings are (offset, length) references into the pool, interned so
+        // repeated values (icons, categories) are stored once. Lists are joined
+        // with '\0'. Bump CacheVersion whenever a record layout changes.
+        constexpr quint32 CacheMagic = 0x43414e55; // "UNAC"
+        constexpr quint32 CacheVersion = 2;
+
+        struct StringRef {
+            quint32 offset;
+            quint32 length;
+        };
+
+        struct Header {
+            quint32 magic;
+            quint32 version;
+            quint32 dirCount;
+            quint32 fileCount;
+            quint32 actionCount;
+            quint32 poolLength;
+            StringRef locale; // localized values are only valid for the locale they were read with
+        };
+
+        struct DirRecord {
+            StringRef path;
+            StringRef subdirs;
+            qint64 modified;
+            quint32 firstFile;
+            quint32 fileCount;
+        };
+
+        enum FileField {
+            PathField,
+            IdField,
+            NameField,
+            GenericNameField,
+            CommentField,
+            IconField,
+            ExecField,
+            CategoriesField,
+            KeywordsField,
+            WorkingDirectoryField,
+            StartupClassField,
+            FieldCount
+        };
+
+        enum FileFlag : quint32 {
+            IsApplication = 1 << 0, // unset for hidden entries and other types
+            NoDisplay = 1 << 1,
+            RunInTerminal = 1 << 2
+        };
+
+        struct FileRecord {
+            StringRef fields[FieldCount];
+            qint64 modified;
+            quint32 flags;
+            quint32 firstAction;
+            quint32 actionCount;
+            quint32 reserved;
+        };
+
+        struct ActionRecord {
+            StringRef id;
+            StringRef name;
+            StringRef exec;
+            StringRef icon;
+        };
+
+        static_assert(sizeof(Header) == 32);
+        static_assert(sizeof(DirRecord) == 32);
+        static_assert(sizeof(FileRecord) == 112);
+        static_assert(sizeof(ActionRecord) == 32);
+
+        QString localeKey() {
+            QStringList parts;
+            for (const QByteArray& locale : DesktopEntryParser::localeFallbacks()) {
+                parts << QString::fromUtf8(locale);
+            }
+            return parts.join(':');
+        }
+
+        qint64 modifiedTime(const QFileInfo& info) {
+            return info.lastModified().toMSecsSinceEpoch();
+        }
+
+    } // namespace
+
+    AppCatalog* AppCatalog::instance() {
+        static AppCatalog* catalog = [] {
+            auto* created = new AppCatalog(QCoreApplication::instance());
+
+            // Warm up off the GUI thread so the first Applications query finds
+            // the catalog (usually straight from the disk cache) already loaded
+            QThreadPool::globalInstance()->start([created]() {
+                created->snapshot();
+            });
+
+            return created;
+        }();
+        return catalog;
+    }
+
+    AppCatalog::AppCatalog(QObject* parent)
+    : QObject(parent)
+    , m_diskCacheRead(false)
+    , m_stale(true) {
+        // Package installs touch many files at once; announce them as one change
+        m_changeTimer.setSingleShot(true);
+        m_changeTimer.setInterval(250);
+
+        connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &AppCatalog::onDirectoryChanged);
+        connect(&m_changeTimer, &QTimer::timeout, this, &AppCatalog::changed);
+    }
+
+    std::shared_ptr<const AppCatalog::Snapshot> AppCatalog::snapshot() {
+        if (!m_stale) {
+            QMutexLocker locker(&m_mutex);
+            if (m_snapshot) {
+                return m_snapshot;
+            }
+        }
+
+        QMutexLocker loadLocker(&m_loadMutex);
+
+        // Cleared before loading, so changes that land mid-load mark it stale again.
+        // If it was already clear, another thread finished loading while we waited.
+        if (!m_stale.exchange(false)) {
+            QMutexLocker locker(&m_mutex);
+            return m_snapshot;
+        }
+
+        QStringList scannedDirs;
+        const auto fresh = load(scannedDirs);
+
+        {
+            QMutexLocker locker(&m_mutex);
+            m_snapshot = fresh;
+        }
+
+        // The watcher lives on the GUI thread
+        QMetaObject::invokeMethod(this, [this, scannedDirs]() {
+            watchDirs(scannedDirs);
+        }, Qt::QueuedConnection);
+
+        return fresh;
+    }
+
+    std::shared_ptr<const DesktopEntryData> AppCatalog::find(const QString& path) const {
+        QMutexLocker locker(&m_mutex);
+        if (!m_snapshot) {
+            return nullptr;
+        }
+
+        const auto it = m_snapshot->byPath.constFind(path);
+        return it == m_snapshot->byPath.constEnd() ? nullptr : m_snapshot->apps.at(it.value()).data;
+    }
+
+    std::shared_ptr<const AppCatalog::Snapshot> AppCatalog::load(QStringList& scannedDirs) {
+        if (!m_diskCacheRead) {
+            m_diskCacheRead = true;
+            readDiskCache();
+        }
+
+        QSet<QString> dirtyDirs;
+        {
+            QMutexLocker locker(&m_dirtyMutex);
+            dirtyDirs.swap(m_dirtyDirs);
+        }
+
+        auto snapshot = std::make_shared<Snapshot>();
+        QHash<QString, CachedDir> dirCache;
+        QSet<QString> seenIds;
+        bool rescanned = false;
+
+        const QStringList appDirs = DesktopEntryParser::resolveXdgDataDirs();
+        for (const QString& appDir : appDirs) {
+            QStringList pending { appDir };
+
+            while (!pending.isEmpty()) {
+                const QString dir = pending.takeFirst();
+                const QFileInfo dirInfo(dir);
+                if (!dirInfo.isDir()) {
+                    continue;
+                }
+                scannedDirs << dir;
+
+                // A directory's mtime changes whenever an entry is added, removed
+                // or renamed (package managers replace files by renaming), so an
+                // unchanged mtime means its listing can be reused as-is
+                const qint64 modified = modifiedTime(dirInfo);
+                const auto previous = m_dirCache.constFind(dir);
+                const bool reusable = previous != m_dirCache.constEnd() && previous->modified == modified &&
+                                      !dirtyDirs.contains(dir);
+
+                CachedDir cached;
+                if (reusable) {
+                    cached = previous.value();
+                } else {
+                    cached = scanDir(dir, appDir, modified, previous != m_dirCache.constEnd() ? &previous.value() : nullptr);
+                    rescanned = true;
+                }
+
+                // Depth-first, in listing order, like QDirIterator::Subdirectories
+                for (qsizetype i = cached.subdirs.size() - 1; i >= 0; --i) {
+                    pending.prepend(cached.subdirs.at(i));
+                }
+
+                for (const CachedFile& file : std::as_const(cached.files)) {
+                    // Deduplication: the first directory in XDG order wins, even if
+                    // its entry turns out to be hidden or not an application
+                    if (seenIds.contains(file.id)) {
+                        continue;
+                    }
+                    seenIds.insert(file.id);
+
+                    if (!file.data) {
+                        continue;
+                    }
+
+                    const auto& data = *file.data;
+                    const QString searchText = data.name + " " +
+                                               data.genericName + " " +
+                                               data.comment + " " +
+                                               data.keywords.join(' ');
+
+                    snapshot->byPath.insert(file.path, snapshot->apps.size());
+                    snapshot->apps.append(App { file.path, file.data, searchText });
+                }
+
+                dirCache.insert(dir, std::move(cached));
+            }
+        }
+
+        // Vanished directories also make the disk cache outdated
+        const bool changed = rescanned || dirCache.size() != m_dirCache.size();
+        m_dirCache.swap(dirCache);
+
+        if (changed) {
+            writeDiskCache();
+        }
+
+        return snapshot;
+    }
+
+    AppCatalog::CachedDir AppCatalog::scanDir(const QString& dir, const QString& appRoot, qint64 modified,
+                                              const CachedDir* previous) {
+        QHash<QString, const CachedFile*> previousFiles;
+        if (previous) {
+            for (const CachedFile& file : previous->files) {
+                previousFiles.insert(file.path, &file);
+            }
+        }
+
+        CachedDir result;
+        result.modified = modified;
+
+        const qsizetype prefixLength = appRoot.length() + 1;
+
+        QDirIterator iter(dir, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+        while (iter.hasNext()) {
+            const QString path = iter.next();
+            const QFileInfo info = iter.fileInfo();
+
+            if (info.isDir()) {
+                // Like QDirIterator::Subdirectories, don't follow symlinked dirs
+                if (!info.isSymLink()) {
+                    result.subdirs << path;
+                }
+                continue;
+            }
+
+            if (!path.endsWith(QLatin1String(".desktop"))) {
+                continue;
+            }
+
+            CachedFile file;
+            file.path = path;
+            file.modified = modifiedTime(info);
+
+            // Only re-parse files that changed since the last load
+            const CachedFile* old = previousFiles.value(path);
+            if (old && old->modified == file.modified) {
+                result.files.append(*old);
+                continue;
+            }
+
+            // Desktop file ID: path below the applications dir, '/' -> '-'
+            file.id = path.mid(prefixLength);
+            file.id.replace('/', '-');
+
+            if (auto parsed = DesktopEntryParser::parse(path)) {
+                parsed->id = file.id;
+                file.data = std::make_shared<const DesktopEntryData>(std::move(*parsed));
+            }
+            result.files.append(file);
+        }
+
+        return result;
+    }
+
+    QString AppCatalog::diskCachePath() {
+        return QDir::homePath() + "/.cache/unite/app-catalog.bin";
+    }
+
+    void AppCatalog::readDiskCache() {
+        QFile file(diskCachePath());
+        if (!file.open(QIODevice::ReadOnly) || file.size() < qint64(sizeof(Header))) {
+            return;
+        }
+
+        QByteArray buffer;
+        const uchar* begin = file.map(0, file.size());
+        const qint64 size = file.size();
+        if (!begin) {
+            buffer = file.readAll();
+            begin = reinterpret_cast<const uchar*>(buffer.constData());
+        }
+
+        Header header;
+        std::memcpy(&header, begin, sizeof(Header));
+        if (header.magic != CacheMagic || header.version != CacheVersion) {
+            return;
+        }
+
+        const qint64 dirsOffset = sizeof(Header);
+        const qint64 filesOffset = dirsOffset + qint64(header.dirCount) * qint64(sizeof(DirRecord));
+        const qint64 actionsOffset = filesOffset + qint64(header.fileCount) * qint64(sizeof(FileRecord));
+        const qint64 poolOffset = actionsOffset + qint64(header.actionCount) * qint64(sizeof(ActionRecord));
+        if (poolOffset + qint64(header.poolLength) * qint64(sizeof(QChar)) != size) {
+            return; // Truncated or otherwise damaged
+        }
+
+        const auto* pool = reinterpret_cast<const QChar*>(begin + poolOffset);
+        bool valid = true;
+        const auto string = [&](StringRef ref) {
+            if (quint64(ref.offset) + ref.length > header.poolLength) {
+                valid = false;
+                return QString();
+            }
+            return QString(pool + ref.offset, ref.length);
+        };
+        const auto list = [&](StringRef ref) {
+            return string(ref).split(QChar(0), Qt::SkipEmptyParts);
+        };
+
+        // Localized names were resolved for the locale the cache was written in
+        if (string(header.locale) != localeKey() || !valid) {
+            return;
+        }
+
+        QHash<QString, CachedDir> dirCache;
+        dirCache.reserve(header.dirCount);
+
+        for (quint32 d = 0; d < header.dirCount && valid; ++d) {
+            DirRecord dirRecord;
+            std::memcpy(&dirRecord, begin + dirsOffset + qint64(d) * qint64(sizeof(DirRecord)), sizeof(DirRecord));
+            if (quint64(dirRecord.firstFile) + dirRecord.fileCount > header.fileCount) {
+                valid = false;
+                break;
+            }
+
+            CachedDir dir;
+            dir.modified = dirRecord.modified;
+            dir.subdirs = list(dirRecord.subdirs);
+            dir.files.reserve(dirRecord.fileCount);
+
+            for (quint32 f = dirRecord.firstFile; f < dirRecord.firstFile + dirRecord.fileCount && valid; ++f) {
+                FileRecord record;
+                std::memcpy(&record, begin + filesOffset + qint64(f) * qint64(sizeof(FileRecord)), sizeof(FileRecord));
+
+                CachedFile cached;
+                cached.path = string(record.fields[PathField]);
+                cached.id = string(record.fields[IdField]);
+                cached.modified = record.modified;
+
+                if (record.flags & IsApplication) {
+                    if (quint64(record.firstAction) + record.actionCount > header.actionCount) {
+                        valid = false;
+                        break;
+                    }
+
+                    DesktopEntryData data;
+                    data.id = cached.id;
+                    data.name = string(record.fields[NameField]);
+                    data.genericName = string(record.fields[GenericNameField]);
+                    data.comment = string(record.fields[CommentField]);
+                    data.icon = string(record.fields[IconField]);
+                    data.execString = string(record.fields[ExecField]);
+                    data.categories = list(record.fields[CategoriesField]);
+                    data.keywords = list(record.fields[KeywordsField]);
+                    data.workingDirectory = string(record.fields[WorkingDirectoryField]);
+                    data.startupClass = string(record.fields[StartupClassField]);
+                    data.noDisplay = record.flags & NoDisplay;
+                    data.runInTerminal = record.flags & RunInTerminal;
+
+                    for (quint32 a = record.firstAction; a < record.firstAction + record.actionCount; ++a) {
+                        ActionRecord action;
+                        std::memcpy(&action, begin + actionsOffset + qint64(a) * qint64(sizeof(ActionRecord)),
+                                    sizeof(ActionRecord));
+                        data.actions.append(DesktopActionSpec {
+                            string(action.id), string(action.name), string(action.exec), string(action.icon)
+                        });
+                    }
+
+                    for (QString& category : data.categories) {
+                        category = DesktopEntryParser::intern(category);
+                    }
+                    for (QString& keyword : data.keywords) {
+                        keyword = DesktopEntryParser::intern(keyword);
+                    }
+
+                    cached.data = std::make_shared<const DesktopEntryData>(std::move(data));
+                }
+
+                dir.files.append(cached);
+            }
+
+            dirCache.insert(string(dirRecord.path), std::move(dir));
+        }
+
+        if (valid) {
+            m_dirCache.swap(dirCache);
+        }
+    }
+
+    void AppCatalog::writeDiskCache() const {
+        QVector<DirRecord> dirs;
+        QVector<FileRecord> files;
+        QVector<ActionRecord> actions;
+        QString pool;
+        QHash<QString, StringRef> interned;
+
+        const auto intern = [&](const QString& value) {
+            if (value.isEmpty()) {
+                return StringRef { 0, 0 };
+            }
+
+            const auto it = interned.constFind(value);
+            if (it != interned.constEnd()) {
+                return it.value();
+            }
+
+            const StringRef ref { quint32(pool.size()), quint32(value.size()) };
+            pool += value;
+            interned.insert(value, ref);
+            return ref;
+        };
+        const auto internList = [&](const QStringList& values) {
+            return intern(values.join(QChar(0)));
+        };
+
+        dirs.reserve(m_dirCache.size());
+        for (auto it = m_dirCache.cbegin(); it != m_dirCache.cend(); ++it) {
+            DirRecord dirRecord {};
+            dirRecord.path = intern(it.key());
+            dirRecord.subdirs = internList(it->subdirs);
+            dirRecord.modified = it->modified;
+            dirRecord.firstFile = quint32(files.size());
+            dirRecord.fileCount = quint32(it->files.size());
+            dirs.append(dirRecord);
+
+            for (const CachedFile& file : it->files) {
+                FileRecord record {};
+                record.fields[PathField] = intern(file.path);
+                record.fields[IdField] = intern(file.id);
+                record.modified = file.modified;
+                record.firstAction = quint32(actions.size());
+
+                if (file.data) {
+                    const DesktopEntryData& data = *file.data;
+                    record.fields[NameField] = intern(data.name);
+                    record.fields[GenericNameField] = intern(data.genericName);
+                    record.fields[CommentField] = intern(data.comment);
+                    record.fields[IconField] = intern(data.icon);
+                    record.fields[ExecField] = intern(data.execString);
+                    record.fields[CategoriesField] = internList(data.categories);
+                    record.fields[KeywordsField] = internList(data.keywords);
+                    record.fields[WorkingDirectoryField] = intern(data.workingDirectory);
+                    record.fields[StartupClassField] = intern(data.startupClass);
+
+                    record.flags = IsApplication;
+                    if (data.noDisplay) {
+                        record.flags |= NoDisplay;
+                    }
+                    if (data.runInTerminal) {
+                        record.flags |= RunInTerminal;
+                    }
+
+                    for (const DesktopActionSpec& action : data.actions) {
+                        actions.append(ActionRecord {
+                            intern(action.id), intern(action.name), intern(action.exec), intern(action.icon)
+                        });
+                    }
+                    record.actionCount = quint32(data.actions.size());
+                }
+
+                files.append(record);
+            }
+        }
+
+        Header header {};
+        header.magic = CacheMagic;
+        header.version = CacheVersion;
+        header.dirCount = quint32(dirs.size());
+        header.fileCount = quint32(files.size());
+        header.actionCount = quint32(actions.size());
+        header.locale = intern(localeKey());
+        header.poolLength = quint32(pool.size());
+
+        const QString path = diskCachePath();
+        QDir().mkpath(QFileInfo(path).absolutePath());
+
+        // Written to a temporary file and renamed, so readers never see half a cache
+        QSaveFile out(path);
+        if (!out.open(QIODevice::WriteOnly)) {
+            return;
+        }
+
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        out.write(reinterpret_cast<const char*>(dirs.constData()), dirs.size() * qsizetype(sizeof(DirRecord)));
+        out.write(reinterpret_cast<const char*>(files.constData()), files.size() * qsizetype(sizeof(FileRecord)));
+        out.write(reinterpret_cast<const char*>(actions.constData()), actions.size() * qsizetype(sizeof(ActionRecord)));
+        out.write(reinterpret_cast<const char*>(pool.constData()), pool.size() * qsizetype(sizeof(QChar)));
+        out.commit();
+    }
+
+    void AppCatalog::watchDirs(const QStringList& dirs) {
+        const QStringList watched = m_watcher.directories();
+
+        QStringList added;
+        for (const QString& dir : dirs) {
+            if (!watched.contains(dir)) {
+                added << dir;
+            }
+        }
+
+        if (!added.isEmpty()) {
+            m_watcher.addPaths(added);
+        }
+    }
+
+    void AppCatalog::onDirectoryChanged(const QString& dir) {
+        {
+            QMutexLocker locker(&m_dirtyMutex);
+            m_dirtyDirs.insert(dir);
+        }
+
+        m_stale = true;
+        m_changeTimer.start();
+    }
+
+} // namespace quicksearch::models
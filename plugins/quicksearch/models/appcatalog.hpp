@@ -0,0 +1,102 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+#include "desktopentry.hpp"
+
+namespace quicksearch::models {
+
+    // Process-wide catalog of installed applications.
+    //
+    // Every .desktop file in the XDG application directories is parsed once
+    // and deduplicated by desktop ID (the first directory in XDG order wins).
+    // The directories are watched; a change marks the catalog stale, and the
+    // next snapshot() re-lists only directories whose mtime changed (or that
+    // the watcher reported), re-parsing only files whose mtime changed. Models
+    // query the snapshot instead of touching the disk per keystroke.
+    //
+    // The parsed catalog is also persisted to ~/.cache/unite/app-catalog.bin,
+    // so the first load after login only has to stat the directories.
+    //
+    // instance() must first be called from the GUI thread. snapshot() is
+    // meant for worker threads; find() never loads and is cheap anywhere.
+    class AppCatalog : public QObject {
+        Q_OBJECT
+
+    public:
+        struct App {
+            QString path;
+            std::shared_ptr<const DesktopEntryData> data;
+            QString searchText; // Name, GenericName, Comment and Keywords, for fuzzy matching
+        };
+
+        struct Snapshot {
+            QVector<App> apps;
+            QHash<QString, qsizetype> byPath;
+        };
+
+        static AppCatalog* instance();
+
+        // Current catalog, (re)loading it first if it is missing or stale
+        [[nodiscard]] std::shared_ptr<const Snapshot> snapshot();
+
+        // Parsed data for a .desktop file if it is in the loaded catalog
+        [[nodiscard]] std::shared_ptr<const DesktopEntryData> find(const QString& path) const;
+
+    signals:
+        // The application directories changed; re-query the snapshot
+        void changed();
+
+    private:
+        explicit AppCatalog(QObject* parent = nullptr);
+
+        struct CachedFile {
+            QString path;
+            QString id;
+            qint64 modified = 0;
+            std::shared_ptr<const DesktopEntryData> data; // null if hidden or not an application
+        };
+
+        // One directory, not recursive: its .desktop files in listing order
+        struct CachedDir {
+            qint64 modified = 0;
+            QVector<CachedFile> files;
+            QStringList subdirs;
+        };
+
+        QFileSystemWatcher m_watcher;
+        QTimer m_changeTimer;
+
+        QMutex m_loadMutex;                    // serialises loads, guards the members below
+        QHash<QString, CachedDir> m_dirCache;  // dir path -> contents
+        bool m_diskCacheRead;
+
+        QMutex m_dirtyMutex;
+        QSet<QString> m_dirtyDirs;             // reported by the watcher since the last load
+
+        mutable QMutex m_mutex;                // guards m_snapshot
+        std::shared_ptr<const Snapshot> m_snapshot;
+        std::atomic_bool m_stale;
+
+        std::shared_ptr<const Snapshot> load(QStringList& scannedDirs);
+        CachedDir scanDir(const QString& dir, const QString& appRoot, qint64 modified, const CachedDir* previous);
+
+        void readDiskCache();
+        void writeDiskCache() const;
+        static QString diskCachePath();
+
+        void watchDirs(const QStringList& dirs);
+        void onDirectoryChanged(const QString& dir);
+    };
+
+} // namespace quicksearch::models
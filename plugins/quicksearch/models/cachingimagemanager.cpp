@@ -0,0 +1,270 @@
+#include "cachingimagemanager.hpp"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QImage>
+#include <QImageReader>
+#include <QQuickWindow>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QtMath>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        // Image.fillMode values we make copies for; the others tile or pad
+        // the image at its own size
+        constexpr int Stretch = 0;
+        constexpr int PreserveAspectFit = 1;
+        constexpr int PreserveAspectCrop = 2;
+
+        // Resizes come in bursts; the copy is made for where they settle
+        constexpr int UpdateDelayMs = 100;
+
+        QString cacheName(const QFileInfo& info, const QSize& size, int fillMode) {
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            hash.addData(info.absoluteFilePath().toUtf8());
+            hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+
+            const char* mode = fillMode == PreserveAspectCrop  ? "crop"
+                               : fillMode == PreserveAspectFit ? "fit"
+                                                               : "stretch";
+            return QString::fromLatin1(hash.result().toHex()) + QStringLiteral("@%1x%2-%3.png")
+                                                                    .arg(size.width())
+                                                                    .arg(size.height())
+                                                                    .arg(QLatin1String(mode));
+        }
+
+        // Size an image of imageSize is drawn at in an item of size pixels
+        QSize fitted(const QSize& imageSize, const QSize& size, int fillMode) {
+            switch (fillMode) {
+            case Stretch:
+                return size;
+            case PreserveAspectFit:
+                return imageSize.scaled(size, Qt::KeepAspectRatio);
+            case PreserveAspectCrop:
+                return imageSize.scaled(size, Qt::KeepAspectRatioByExpanding);
+            default:
+                return imageSize;
+            }
+        }
+
+        // The image as the item shows it, or null if it is no larger than that
+        QImage scaledImage(const QString& path, const QSize& size, int fillMode) {
+            QImageReader reader(path);
+            reader.setAutoTransform(true);
+
+            // Have the decoder scale when it can (JPEG does so in the DCT domain)
+            const QSize stored = reader.size();
+            const bool rotated = reader.transformation() & QImageIOHandler::TransformationRotate90;
+            const QSize shown = rotated ? stored.transposed() : stored;
+            if (shown.isValid()) {
+                const QSize wanted = fitted(shown, size, fillMode);
+                if (wanted.width() >= shown.width() && wanted.height() >= shown.height()) {
+                    return QImage();
+                }
+                reader.setScaledSize(rotated ? wanted.transposed() : wanted);
+            }
+
+            QImage image = reader.read();
+            if (image.isNull()) {
+                return QImage();
+            }
+
+            const QSize wanted = fitted(image.size(), size, fillMode);
+            if (wanted.width() >= image.width() && wanted.height() >= image.height() && !shown.isValid()) {
+                return QImage();
+            }
+            if (image.size() != wanted) {
+                image = image.scaled(wanted, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            }
+
+            // Only the middle is visible when cropping
+            if (fillMode == PreserveAspectCrop && image.size() != size) {
+                image = image.copy((image.width() - size.width()) / 2, (image.height() - size.height()) / 2,
+                                   size.width(), size.height());
+            }
+            return image;
+        }
+
+    } // namespace
+
+    CachingImageManager::CachingImageManager(QObject* parent)
+    : QObject(parent)
+    , m_usingCache(false)
+    , m_generation(0) {
+        m_updateTimer.setSingleShot(true);
+        m_updateTimer.setInterval(UpdateDelayMs);
+        connect(&m_updateTimer, &QTimer::timeout, this, [this]() {
+            updateSource();
+        });
+    }
+
+    QQuickItem* CachingImageManager::item() const {
+        return m_item;
+    }
+
+    void CachingImageManager::setItem(QQuickItem* item) {
+        if (m_item == item) {
+            return;
+        }
+
+        for (const QMetaObject::Connection& connection : std::as_const(m_itemConnections)) {
+            disconnect(connection);
+        }
+        m_itemConnections.clear();
+
+        m_item = item;
+        if (m_item) {
+            const auto schedule = [this]() {
+                m_updateTimer.start();
+            };
+            m_itemConnections << connect(m_item, &QQuickItem::widthChanged, this, schedule)
+                              << connect(m_item, &QQuickItem::heightChanged, this, schedule)
+                              << connect(m_item, &QQuickItem::windowChanged, this, schedule);
+        }
+
+        emit itemChanged();
+        m_updateTimer.start();
+    }
+
+    QUrl CachingImageManager::cacheDir() const {
+        return m_cacheDir;
+    }
+
+    void CachingImageManager::setCacheDir(const QUrl& cacheDir) {
+        if (m_cacheDir == cacheDir) {
+            return;
+        }
+        m_cacheDir = cacheDir;
+        emit cacheDirChanged();
+        m_updateTimer.start();
+    }
+
+    QString CachingImageManager::path() const {
+        return m_path;
+    }
+
+    void CachingImageManager::setPath(const QString& path) {
+        if (m_path == path) {
+            return;
+        }
+        m_path = path;
+        emit pathChanged();
+
+        // Not delayed: the previous image must not stay up
+        updateSource();
+    }
+
+    QUrl CachingImageManager::cachePath() const {
+        return m_cachePath;
+    }
+
+    bool CachingImageManager::usingCache() const {
+        return m_usingCache;
+    }
+
+    void CachingImageManager::updateSource() {
+        updateSource(m_path);
+    }
+
+    void CachingImageManager::updateSource(const QString& path) {
+        m_updateTimer.stop();
+        const quint64 generation = ++m_generation;
+
+        if (path.isEmpty()) {
+            setCachePath(QUrl(), false, QString());
+            return;
+        }
+
+        // No copy can be made outside a local directory; show the image itself
+        if (!m_cacheDir.isEmpty() && !m_cacheDir.isLocalFile()) {
+            setCachePath(QUrl::fromLocalFile(path), false, path);
+            return;
+        }
+
+        // Showing the original until the item is laid out and cacheDir is set
+        // would decode it at full size for nothing. Their change notifications
+        // schedule the copy; another image's copy must not stay up meanwhile.
+        const QSize size = effectiveSize();
+        if (size.isEmpty() || m_cacheDir.isEmpty()) {
+            if (m_source != path) {
+                setCachePath(QUrl(), false, QString());
+            }
+            return;
+        }
+
+        const QString dir = m_cacheDir.toLocalFile();
+        const int fillMode = this->fillMode();
+
+        // A copy made before is used right away; one stat, no decoding
+        const QFileInfo info(path);
+        const QString cache = dir + '/' + cacheName(info, size, fillMode);
+        if (QFileInfo::exists(cache)) {
+            setCachePath(QUrl::fromLocalFile(cache), true, path);
+            return;
+        }
+
+        // Another image's copy must not stay up meanwhile
+        if (m_source != path) {
+            setCachePath(QUrl(), false, QString());
+        }
+
+        QThreadPool::globalInstance()->start(
+            [self = QPointer<CachingImageManager>(this), generation, path, dir, cache, size, fillMode]() {
+                QString result = path;
+                bool cached = false;
+
+                const QImage image = scaledImage(path, size, fillMode);
+                if (!image.isNull() && QDir().mkpath(dir)) {
+                    QSaveFile out(cache);
+                    if (out.open(QIODevice::WriteOnly) && image.save(&out, "PNG") && out.commit()) {
+                        result = cache;
+                        cached = true;
+                    }
+                }
+
+                // Checked on the GUI thread, where the manager lives
+                QMetaObject::invokeMethod(QCoreApplication::instance(), [self, generation, path, result, cached]() {
+                    if (self && self->m_generation == generation) {
+                        self->setCachePath(QUrl::fromLocalFile(result), cached, path);
+                    }
+                }, Qt::QueuedConnection);
+            });
+    }
+
+    void CachingImageManager::setCachePath(const QUrl& cachePath, bool usingCache, const QString& source) {
+        m_source = source;
+
+        if (m_cachePath != cachePath) {
+            m_cachePath = cachePath;
+            emit cachePathChanged();
+        }
+        if (m_usingCache != usingCache) {
+            m_usingCache = usingCache;
+            emit usingCacheChanged();
+        }
+    }
+
+    QSize CachingImageManager::effectiveSize() const {
+        if (!m_item) {
+            return QSize();
+        }
+
+        const qreal scale = m_item->window() ? m_item->window()->effectiveDevicePixelRatio()
+                                             : qGuiApp->devicePixelRatio();
+        return QSize(qCeil(m_item->width() * scale), qCeil(m_item->height() * scale));
+    }
+
+    int CachingImageManager::fillMode() const {
+        // Image's default; other items have no fillMode and get the same
+        const QVariant fillMode = m_item ? m_item->property("fillMode") : QVariant();
+        return fillMode.isValid() ? fillMode.toInt() : Stretch;
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QList>
+#include <QMetaObject>
+#include <QObject>
+#include <QPointer>
+#include <QQuickItem>
+#include <QSize>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+#include <qqmlintegration.h>
+
+namespace quicksearch::models {
+
+    // Keeps a copy of an image scaled to exactly the pixel size of the item
+    // showing it, so large images (wallpapers) are decoded at full size once
+    // rather than every time they are shown.
+    //
+    // The copy is <cacheDir>/<sha256 of path and mtime>@<w>x<h>-<fill
+    // mode>.png, where the size is the item's size times the window's device
+    // pixel ratio, and the item's fillMode (if it has one) decides between
+    // fitting, cropping and stretching. It is made on a worker and swapped
+    // into cachePath when ready; until then, including while the item has no
+    // size or cacheDir isn't set yet, cachePath keeps the previous copy of the
+    // same image, or is empty. Images already small enough, and ones no copy
+    // can be made of, are used as they are. Changes to the item's size or window update it, coalesced
+    // while the item is being resized.
+    class CachingImageManager : public QObject {
+        Q_OBJECT
+        QML_ELEMENT
+
+        Q_PROPERTY(QQuickItem* item READ item WRITE setItem NOTIFY itemChanged REQUIRED)
+        Q_PROPERTY(QUrl cacheDir READ cacheDir WRITE setCacheDir NOTIFY cacheDirChanged REQUIRED)
+        Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged)
+        Q_PROPERTY(QUrl cachePath READ cachePath NOTIFY cachePathChanged)
+        Q_PROPERTY(bool usingCache READ usingCache NOTIFY usingCacheChanged)
+
+    public:
+        explicit CachingImageManager(QObject* parent = nullptr);
+
+        [[nodiscard]] QQuickItem* item() const;
+        void setItem(QQuickItem* item);
+
+        [[nodiscard]] QUrl cacheDir() const;
+        void setCacheDir(const QUrl& cacheDir);
+
+        [[nodiscard]] QString path() const;
+        void setPath(const QString& path);
+
+        [[nodiscard]] QUrl cachePath() const;
+        [[nodiscard]] bool usingCache() const;
+
+        Q_INVOKABLE void updateSource();
+        Q_INVOKABLE void updateSource(const QString& path);
+
+    signals:
+        void itemChanged();
+        void cacheDirChanged();
+        void pathChanged();
+        void cachePathChanged();
+        void usingCacheChanged();
+
+    private:
+        QPointer<QQuickItem> m_item;
+        QUrl m_cacheDir;
+        QString m_path;
+        QUrl m_cachePath;
+        bool m_usingCache;
+
+        QString m_source; // image cachePath shows a copy of
+        QList<QMetaObject::Connection> m_itemConnections;
+        QTimer m_updateTimer;
+        quint64 m_generation; // bumped per request; older results are dropped
+
+        void setCachePath(const QUrl& cachePath, bool usingCache, const QString& source);
+
+        // The item's size in device pixels
+        [[nodiscard]] QSize effectiveSize() const;
+        [[nodiscard]] int fillMode() const;
+    };
+
+} // namespace quicksearch::models
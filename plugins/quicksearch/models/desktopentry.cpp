@@ -1,22 +1,59 @@
 #include "desktopentry.hpp"
+#include "frecencystore.hpp"
+#include "iconresolver.hpp"
 
-#include <QSettings>
+#include <QFile>
 #include <QFileInfo>
 #include <QDir>
 #include <QLocale>
 #include <QDebug>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+#include <cstring>
+#include <limits>
 
 namespace quicksearch::models {
 
-    DesktopAction::DesktopAction(const QString& actionId, const QString& actionName,
-                                const QString& exec, const QString& iconName,
-                                QObject* parent)
+    DesktopAction::DesktopAction(const DesktopActionSpec& spec, const LaunchRequest& app, QObject* parent)
     : QObject(parent)
-    , m_id(actionId)
-    , m_name(actionName)
-    , m_execString(exec)
-    , m_icon(iconName)
-    , m_command(DesktopEntryParser::parseExecString(exec)) {
+    , m_id(spec.id)
+    , m_name(spec.name)
+    , m_execString(spec.exec)
+    , m_icon(spec.icon)
+    , m_launch(app)
+    , m_commandInitialised(false) {
+        m_launch.exec = spec.exec;
+        if (!spec.icon.isEmpty()) {
+            m_launch.icon = spec.icon;
+        }
+    }
+
+    QString DesktopAction::iconPath() const {
+        auto* resolver = IconResolver::instance();
+        if (!resolver->isReady()) {
+            connect(resolver, &IconResolver::ready, this, &DesktopAction::iconPathChanged, Qt::UniqueConnection);
+            return QString();
+        }
+        return resolver->resolve(m_icon);
+    }
+
+    QStringList DesktopAction::command() const {
+        if (!m_commandInitialised) {
+            m_command = DesktopEntryParser::parseExecString(m_execString);
+            m_commandInitialised = true;
+        }
+        return m_command;
+    }
+
+    void DesktopAction::execute() {
+        if (m_execString.isEmpty()) {
+            qWarning() << "Cannot execute: action has no Exec:" << m_id;
+            return;
+        }
+
+        Launcher::instance()->launch(m_launch);
+        FrecencyStore::instance()->record(m_launch.desktopId);
     }
 
     QStringList DesktopEntryParser::resolveXdgDataDirs() {
@@ -49,6 +86,17 @@ namespace quicksearch::models {
     }
 
     QStringList DesktopEntryParser::parseExecString(const QString& exec) {
+        QStringList result = splitExecString(exec);
+
+        // Skip field codes (%u, %f, %F, %U, etc.)
+        result.removeIf([](const QString& arg) {
+            return arg.startsWith('%');
+        });
+
+        return result;
+    }
+
+    QStringList DesktopEntryParser::splitExecString(const QString& exec) {
         QStringList result;
         QString current;
         bool inQuotes = false;
@@ -75,10 +123,7 @@ namespace quicksearch::models {
 
             if (c == ' ' && !inQuotes) {
                 if (!current.isEmpty()) {
-                    // Skip field codes (%u, %f, %F, %U, etc.)
-                    if (!current.startsWith('%')) {
-                        result.append(current);
-                    }
+                    result.append(current);
                     current.clear();
                 }
                 continue;
@@ -87,95 +132,409 @@ namespace quicksearch::models {
             current += c;
         }
 
-        if (!current.isEmpty() && !current.startsWith('%')) {
+        if (!current.isEmpty()) {
             result.append(current);
         }
 
         return result;
     }
 
-    QString DesktopEntryParser::parseLocalizedKey(QSettings& settings, const QString& key) {
-        // Try locale-specific first
-        QString locale = QLocale::system().name(); // e.g., "en_US"
-        QString lang = locale.split('_').first();  // e.g., "en"
+    const QList<QByteArray>& DesktopEntryParser::localeFallbacks() {
+        static const QList<QByteArray> fallbacks = [] {
+            QByteArray locale = qgetenv("LC_ALL");
+            if (locale.isEmpty()) {
+                locale = qgetenv("LC_MESSAGES");
+            }
+            if (locale.isEmpty()) {
+                locale = qgetenv("LANG");
+            }
+            if (locale.isEmpty() || locale == "C" || locale == "POSIX") {
+                locale = QLocale::system().name().toUtf8(); // e.g., "en_US"
+            }
+
+            // lang_COUNTRY.ENCODING@MODIFIER
+            QByteArray modifier;
+            const auto at = locale.indexOf('@');
+            if (at >= 0) {
+                modifier = locale.mid(at + 1);
+                locale.truncate(at);
+            }
+
+            const auto dot = locale.indexOf('.');
+            if (dot >= 0) {
+                locale.truncate(dot);
+            }
+
+            QByteArray country;
+            const auto underscore = locale.indexOf('_');
+            if (underscore >= 0) {
+                country = locale.mid(underscore + 1);
+                locale.truncate(underscore);
+            }
+
+            const QByteArray& lang = locale;
+            QList<QByteArray> result;
+            if (lang.isEmpty() || lang == "C") {
+                return result;
+            }
 
-        // Try full locale
-        QString value = settings.value(key + "[" + locale + "]").toString();
-        if (!value.isEmpty()) {
-            return value;
+            if (!country.isEmpty() && !modifier.isEmpty()) {
+                result << lang + '_' + country + '@' + modifier;
+            }
+            if (!country.isEmpty()) {
+                result << lang + '_' + country;
+            }
+            if (!modifier.isEmpty()) {
+                result << lang + '@' + modifier;
+            }
+            result << lang;
+
+            return result;
+        }();
+
+        return fallbacks;
+    }
+
+    QString DesktopEntryParser::intern(const QString& value) {
+        static QMutex mutex;
+        static QSet<QString> strings;
+
+        QMutexLocker locker(&mutex);
+        const auto it = strings.constFind(value);
+        if (it != strings.constEnd()) {
+            return *it;
+        }
+        strings.insert(value);
+        return value;
+    }
+
+    QString DesktopEntryParser::unescapeValue(QByteArrayView value) {
+        if (value.isEmpty()) {
+            return QString();
         }
 
-        // Try language only
-        value = settings.value(key + "[" + lang + "]").toString();
-        if (!value.isEmpty()) {
-            return value;
+        if (!std::memchr(value.data(), '\\', value.size())) {
+            return QString::fromUtf8(value);
         }
 
-        // Fall back to unlocalized
-        return settings.value(key).toString();
+        QByteArray result;
+        result.reserve(value.size());
+
+        for (qsizetype i = 0; i < value.size(); ++i) {
+            const char c = value[i];
+            if (c != '\\' || i + 1 == value.size()) {
+                result += c;
+                continue;
+            }
+
+            const char next = value[++i];
+            switch (next) {
+            case 's':
+                result += ' ';
+                break;
+            case 'n':
+                result += '\n';
+                break;
+            case 't':
+                result += '\t';
+                break;
+            case 'r':
+                result += '\r';
+                break;
+            case '\\':
+                result += '\\';
+                break;
+            default:
+                result += '\\';
+                result += next;
+                break;
+            }
+        }
+
+        return QString::fromUtf8(result);
     }
 
-    std::optional<DesktopEntryData> DesktopEntryParser::parse(const QString& filePath) {
-        QSettings settings(filePath, QSettings::IniFormat);
+    QStringList DesktopEntryParser::splitList(QByteArrayView value) {
+        QStringList items;
+        QByteArray current;
+
+        for (qsizetype i = 0; i < value.size(); ++i) {
+            const char c = value[i];
+
+            if (c == '\\' && i + 1 < value.size()) {
+                const char next = value[++i];
+                if (next == ';') {
+                    current += ';';
+                } else {
+                    // Leave other escapes for unescapeValue()
+                    current += c;
+                    current += next;
+                }
+                continue;
+            }
+
+            if (c == ';') {
+                if (!current.isEmpty()) {
+                    items << unescapeValue(current);
+                    current.clear();
+                }
+                continue;
+            }
+
+            current += c;
+        }
+
+        if (!current.isEmpty()) {
+            items << unescapeValue(current);
+        }
+
+        return items;
+    }
+
+    namespace {
+
+        enum class Group {
+            None,
+            Entry,
+            Action,
+            Other
+        };
+
+        // A localized key keeps the best variant seen so far. Rank is the
+        // position in the locale fallback chain, the unlocalized key ranks last.
+        struct LocalizedValue {
+            QByteArrayView value;
+            int rank = std::numeric_limits<int>::max();
+
+            void offer(QByteArrayView candidate, int candidateRank) {
+                if (candidateRank < rank) {
+                    value = candidate;
+                    rank = candidateRank;
+                }
+            }
+        };
+
+        struct RawAction {
+            QByteArrayView id;
+            LocalizedValue name;
+            QByteArrayView exec;
+            QByteArrayView icon;
+        };
+
+        QByteArrayView trimmed(QByteArrayView view) {
+            qsizetype begin = 0;
+            qsizetype end = view.size();
+            while (begin < end && (view[begin] == ' ' || view[begin] == '\t')) {
+                ++begin;
+            }
+            while (end > begin && (view[end - 1] == ' ' || view[end - 1] == '\t' || view[end - 1] == '\r')) {
+                --end;
+            }
+            return view.sliced(begin, end - begin);
+        }
 
-        // Verify Type=Application
-        settings.beginGroup("Desktop Entry");
-        QString type = settings.value("Type").toString();
-        if (type != "Application") {
-            settings.endGroup();
+        bool isTrue(QByteArrayView value) {
+            return value == "true" || value == "1";
+        }
+
+    } // namespace
+
+    std::optional<DesktopEntryData> DesktopEntryParser::parse(const QString& filePath) {
+        QFile file(filePath);
+        if (!file.open(QIODevice::ReadOnly) || file.size() == 0) {
             return std::nullopt;
         }
 
-        DesktopEntryData data;
+        // Map the file; fall back to reading it if the filesystem can't map.
+        // All views below point into this memory and are decoded before return.
+        QByteArray buffer;
+        const char* begin = reinterpret_cast<const char*>(file.map(0, file.size()));
+        qsizetype size = file.size();
+        if (!begin) {
+            buffer = file.readAll();
+            begin = buffer.constData();
+            size = buffer.size();
+        }
+        const char* const end = begin + size;
 
-        // Basic properties with localization support
-        data.name = parseLocalizedKey(settings, "Name");
-        data.genericName = parseLocalizedKey(settings, "GenericName");
-        data.comment = parseLocalizedKey(settings, "Comment");
-        data.icon = settings.value("Icon").toString();
-        data.execString = settings.value("Exec").toString();
-        data.command = parseExecString(data.execString);
+        // Skip a UTF-8 byte order mark
+        if (size >= 3 && std::memcmp(begin, "\xEF\xBB\xBF", 3) == 0) {
+            begin += 3;
+        }
 
-        // Lists (semicolon-separated)
-        QString categoriesStr = settings.value("Categories").toString();
-        data.categories = categoriesStr.split(';', Qt::SkipEmptyParts);
+        const QList<QByteArray>& locales = localeFallbacks();
+        const int defaultRank = static_cast<int>(locales.size());
+
+        Group group = Group::None;
+        bool seenEntryGroup = false;
+
+        QByteArrayView type;
+        LocalizedValue name;
+        LocalizedValue genericName;
+        LocalizedValue comment;
+        LocalizedValue keywords;
+        QByteArrayView icon;
+        QByteArrayView exec;
+        QByteArrayView categories;
+        QByteArrayView actionIds;
+        QByteArrayView path;
+        QByteArrayView startupClass;
+        bool noDisplay = false;
+        bool hidden = false;
+        bool runInTerminal = false;
+        QList<RawAction> rawActions;
+
+        for (const char* cursor = begin; cursor < end;) {
+            const auto* newline = static_cast<const char*>(std::memchr(cursor, '\n', end - cursor));
+            const char* lineEnd = newline ? newline : end;
+            const QByteArrayView line = trimmed(QByteArrayView(cursor, lineEnd - cursor));
+            cursor = lineEnd + 1;
+
+            if (line.isEmpty() || line.front() == '#') {
+                continue;
+            }
 
-        QString keywordsStr = parseLocalizedKey(settings, "Keywords");
-        data.keywords = keywordsStr.split(';', Qt::SkipEmptyParts);
+            if (line.front() == '[') {
+                if (line.back() != ']') {
+                    group = Group::Other;
+                    continue;
+                }
 
-        // Booleans
-        data.noDisplay = settings.value("NoDisplay", false).toBool();
-        data.runInTerminal = settings.value("Terminal", false).toBool();
+                const QByteArrayView groupName = line.sliced(1, line.size() - 2);
+                if (groupName == "Desktop Entry") {
+                    // Only the first [Desktop Entry] counts
+                    group = seenEntryGroup ? Group::Other : Group::Entry;
+                    seenEntryGroup = true;
+                } else if (groupName.startsWith("Desktop Action ")) {
+                    group = Group::Action;
+                    rawActions.append(RawAction { groupName.sliced(15), {}, {}, {} });
+                } else {
+                    group = Group::Other;
+                }
+                continue;
+            }
 
-        // Additional properties
-        data.workingDirectory = settings.value("Path").toString();
-        data.startupClass = settings.value("StartupWMClass").toString();
-        data.id = QFileInfo(filePath).fileName();
+            if (group == Group::None || group == Group::Other) {
+                continue;
+            }
 
-        settings.endGroup();
+            const auto* equals = static_cast<const char*>(std::memchr(line.data(), '=', line.size()));
+            if (!equals) {
+                continue;
+            }
 
-        // Parse Desktop Actions
-        settings.beginGroup("Desktop Entry");
-        QString actionsStr = settings.value("Actions").toString();
-        settings.endGroup();
+            QByteArrayView key = trimmed(QByteArrayView(line.data(), equals - line.data()));
+            const QByteArrayView value = trimmed(QByteArrayView(equals + 1, line.data() + line.size() - equals - 1));
 
-        QStringList actionIds = actionsStr.split(';', Qt::SkipEmptyParts);
+            // Split off and rank a locale suffix: Key[locale]
+            int rank = defaultRank;
+            if (key.endsWith(']')) {
+                const auto* bracket = static_cast<const char*>(std::memchr(key.data(), '[', key.size()));
+                if (!bracket) {
+                    continue;
+                }
+
+                const qsizetype bracketPos = bracket - key.data();
+                const QByteArrayView locale = key.sliced(bracketPos + 1, key.size() - bracketPos - 2);
+                key = key.first(bracketPos);
 
-        for (const QString& actionId : actionIds) {
-            QString groupName = "Desktop Action " + actionId;
-            if (settings.childGroups().contains(groupName)) {
-                settings.beginGroup(groupName);
+                rank = -1;
+                for (int i = 0; i < defaultRank; ++i) {
+                    if (QByteArrayView(locales.at(i)) == locale) {
+                        rank = i;
+                        break;
+                    }
+                }
+                if (rank < 0) {
+                    continue; // Not a locale we'd ever show
+                }
+            }
 
-                QString actionName = parseLocalizedKey(settings, "Name");
-                QString actionExec = settings.value("Exec").toString();
-                QString actionIcon = settings.value("Icon").toString();
+            if (group == Group::Action) {
+                RawAction& action = rawActions.last();
+                if (key == "Name") {
+                    action.name.offer(value, rank);
+                } else if (rank == defaultRank && key == "Exec") {
+                    action.exec = value;
+                } else if (rank == defaultRank && key == "Icon") {
+                    action.icon = value;
+                }
+                continue;
+            }
 
-                auto* action = new DesktopAction(
-                    actionId, actionName, actionExec, actionIcon, nullptr
-                );
-                data.actions.append(action);
+            if (key == "Name") {
+                name.offer(value, rank);
+            } else if (key == "GenericName") {
+                genericName.offer(value, rank);
+            } else if (key == "Comment") {
+                comment.offer(value, rank);
+            } else if (key == "Keywords") {
+                keywords.offer(value, rank);
+            } else if (rank != defaultRank) {
+                continue; // Nothing else we read is localized
+            } else if (key == "Type") {
+                type = value;
+            } else if (key == "Icon") {
+                icon = value;
+            } else if (key == "Exec") {
+                exec = value;
+            } else if (key == "Categories") {
+                categories = value;
+            } else if (key == "Actions") {
+                actionIds = value;
+            } else if (key == "Path") {
+                path = value;
+            } else if (key == "StartupWMClass") {
+                startupClass = value;
+            } else if (key == "NoDisplay") {
+                noDisplay = isTrue(value);
+            } else if (key == "Hidden") {
+                hidden = isTrue(value);
+            } else if (key == "Terminal") {
+                runInTerminal = isTrue(value);
+            }
+        }
+
+        // Verify Type=Application; Hidden=true means the entry was deleted
+        if (type != "Application" || hidden) {
+            return std::nullopt;
+        }
+
+        DesktopEntryData data;
+
+        data.name = unescapeValue(name.value);
+        data.genericName = unescapeValue(genericName.value);
+        data.comment = unescapeValue(comment.value);
+        data.icon = unescapeValue(icon);
+        data.execString = unescapeValue(exec);
+        data.categories = splitList(categories);
+        data.keywords = splitList(keywords.value);
+        data.noDisplay = noDisplay;
+        data.runInTerminal = runInTerminal;
+        data.workingDirectory = unescapeValue(path);
+        data.startupClass = unescapeValue(startupClass);
+        data.id = QFileInfo(filePath).fileName();
+
+        for (QString& category : data.categories) {
+            category = intern(category);
+        }
+        for (QString& keyword : data.keywords) {
+            keyword = intern(keyword);
+        }
+
+        // Desktop Actions, in the order the Actions key lists them
+        const QStringList ids = splitList(actionIds);
+        for (const QString& actionId : ids) {
+            const QByteArray idUtf8 = actionId.toUtf8();
+            for (const RawAction& raw : std::as_const(rawActions)) {
+                if (raw.id != QByteArrayView(idUtf8)) {
+                    continue;
+                }
 
-                settings.endGroup();
+                data.actions.append(DesktopActionSpec {
+                    actionId, unescapeValue(raw.name.value), unescapeValue(raw.exec), unescapeValue(raw.icon)
+                });
+                break;
             }
         }
 
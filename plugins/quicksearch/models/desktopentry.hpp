@@ -3,16 +3,28 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QByteArray>
+#include <QByteArrayView>
 #include <QList>
-#include <QSettings>
 #include <qqmlintegration.h>
 #include <optional>
 
+#include "launcher.hpp"
+
 namespace quicksearch::models {
 
     // Forward declaration
     class DesktopAction;
 
+    // [Desktop Action] group as plain data; the QObject is only created when
+    // QML reads FileSystemEntry::actions
+    struct DesktopActionSpec {
+        QString id;
+        QString name;
+        QString exec;
+        QString icon;
+    };
+
     // Desktop Action - matches Quickshell DesktopAction API
     class DesktopAction : public QObject {
         Q_OBJECT
@@ -23,75 +35,92 @@ namespace quicksearch::models {
         Q_PROPERTY(QString name READ name CONSTANT)
         Q_PROPERTY(QString execString READ execString CONSTANT)
         Q_PROPERTY(QString icon READ icon CONSTANT)
+        Q_PROPERTY(QString iconPath READ iconPath NOTIFY iconPathChanged)
         Q_PROPERTY(QStringList command READ command CONSTANT)
 
     public:
-        explicit DesktopAction(const QString& actionId, const QString& actionName,
-                              const QString& exec, const QString& iconName,
-                              QObject* parent = nullptr);
+        // app: launch request of the owning entry; the action's Exec and Icon replace its own
+        explicit DesktopAction(const DesktopActionSpec& spec, const LaunchRequest& app, QObject* parent = nullptr);
 
         [[nodiscard]] QString id() const { return m_id; }
         [[nodiscard]] QString name() const { return m_name; }
         [[nodiscard]] QString execString() const { return m_execString; }
         [[nodiscard]] QString icon() const { return m_icon; }
-        [[nodiscard]] QStringList command() const { return m_command; }
+        [[nodiscard]] QString iconPath() const;
+        [[nodiscard]] QStringList command() const;
+
+        Q_INVOKABLE void execute();
+
+    signals:
+        void iconPathChanged();
 
     private:
         QString m_id;
         QString m_name;
         QString m_execString;
         QString m_icon;
-        QStringList m_command;
+        LaunchRequest m_launch;
+
+        mutable QStringList m_command;
+        mutable bool m_commandInitialised;
     };
 
     // Internal data holder - not exposed to QML
+    //
+    // Plain, implicitly shared values, so the catalog can hand the same record
+    // to any thread. Categories and keywords are interned: the same category
+    // string in a hundred entries shares one buffer.
     struct DesktopEntryData {
         QString name;
         QString genericName;
         QString comment;
         QString icon;
-        QStringList command;
-        QString execString;
+        QString execString; // split with DesktopEntryParser::parseExecString() when launching
         QStringList categories;
         QStringList keywords;
-        QList<DesktopAction*> actions;
+        QList<DesktopActionSpec> actions;
         QString id;
-        bool noDisplay;
-        bool runInTerminal;
         QString workingDirectory;
         QString startupClass;
-
-        ~DesktopEntryData() {
-            qDeleteAll(actions);
-        }
-
-        // Delete copy operations to prevent double-free
-        DesktopEntryData(const DesktopEntryData&) = delete;
-        DesktopEntryData& operator=(const DesktopEntryData&) = delete;
-
-        // Allow move operations
-        DesktopEntryData(DesktopEntryData&&) = default;
-        DesktopEntryData& operator=(DesktopEntryData&&) = default;
-
-        DesktopEntryData() = default;
+        bool noDisplay = false;
+        bool runInTerminal = false;
     };
 
     // Desktop entry parser utility
+    //
+    // Single pass over the mapped file: no intermediate key map, only the keys
+    // we expose are decoded, and values follow the Desktop Entry spec (escape
+    // sequences, `\;` in lists, `Name[lang_COUNTRY@MODIFIER]` fallback).
     class DesktopEntryParser {
     public:
-        // Parse a .desktop file and return its data
+        // Parse a .desktop file and return its data. Returns std::nullopt for
+        // anything but Type=Application, and for Hidden=true (deleted) entries.
         static std::optional<DesktopEntryData> parse(const QString& filePath);
 
         // Parse Exec string, remove field codes, handle quotes
         static QStringList parseExecString(const QString& exec);
 
+        // Split an Exec string into arguments, keeping field codes for expansion
+        static QStringList splitExecString(const QString& exec);
+
         // Resolve XDG application directories
         static QStringList resolveXdgDataDirs();
 
+        // Locale suffixes to look for, best match first, e.g.
+        // sr_YU@Latn, sr_YU, sr@Latn, sr. Resolved once per process from
+        // LC_ALL / LC_MESSAGES / LANG.
+        static const QList<QByteArray>& localeFallbacks();
+
+        // Process-wide shared copy of a string that repeats across entries
+        static QString intern(const QString& value);
+
     private:
-        // Parse localized keys (e.g., Name[en_US])
-        static QString parseLocalizedKey(QSettings& settings,
-                                        const QString& key);
+        // Resolve the general escape sequences (\s \n \t \r \\). Unknown
+        // sequences are kept as-is for the Exec and list parsers.
+        static QString unescapeValue(QByteArrayView value);
+
+        // Split a `;`-separated list, honouring `\;`
+        static QStringList splitList(QByteArrayView value);
     };
 
 } // namespace quicksearch::models
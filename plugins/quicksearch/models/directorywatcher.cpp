@@ -0,0 +1,274 @@
+#include "directorywatcher.hpp"
+#include "pathindex.hpp"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutexLocker>
+#include <cerrno>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        // Entries appearing and disappearing; changes to their contents don't matter here
+        constexpr quint32 WatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+        // Roughly a frame, so a burst of events becomes one update
+        constexpr int FlushInterval = 16;
+
+        // Room for a few hundred events per read
+        constexpr qsizetype BufferSize = 64 * 1024;
+
+        // The live watcher, for indexes going away after the application has
+        // destroyed it; guarded by currentMutex
+        DirectoryWatcher* current = nullptr;
+        QMutex currentMutex;
+
+    } // namespace
+
+    DirectoryWatcher::DirectoryWatcher(QObject* parent)
+    : QObject(parent)
+    , m_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+    , m_wakeFd(eventfd(0, EFD_CLOEXEC))
+    , m_reader(nullptr)
+    , m_limitReached(false)
+    , m_warned(false)
+    , m_flushQueued(false) {
+        m_flushTimer.setSingleShot(true);
+        m_flushTimer.setInterval(FlushInterval);
+        connect(&m_flushTimer, &QTimer::timeout, this, &DirectoryWatcher::flush);
+
+        {
+            QMutexLocker locker(&currentMutex);
+            current = this;
+        }
+
+        if (m_fd < 0 || m_wakeFd < 0) {
+            qWarning() << "Cannot watch directories: inotify unavailable";
+            return;
+        }
+
+        m_reader = QThread::create([this]() {
+            read();
+        });
+        m_reader->start();
+    }
+
+    DirectoryWatcher::~DirectoryWatcher() {
+        {
+            QMutexLocker locker(&currentMutex);
+            current = nullptr;
+        }
+
+        if (m_reader) {
+            const quint64 one = 1;
+            [[maybe_unused]] const auto written = ::write(m_wakeFd, &one, sizeof(one));
+            m_reader->wait();
+            delete m_reader;
+        }
+        if (m_fd >= 0) {
+            ::close(m_fd);
+        }
+        if (m_wakeFd >= 0) {
+            ::close(m_wakeFd);
+        }
+    }
+
+    DirectoryWatcher* DirectoryWatcher::instance() {
+        static DirectoryWatcher* watcher = new DirectoryWatcher(QCoreApplication::instance());
+        return watcher;
+    }
+
+    bool DirectoryWatcher::watch(PathIndex* index, const QString& dir) {
+        if (m_fd < 0) {
+            return false;
+        }
+
+        QMutexLocker locker(&m_mutex);
+        const auto known = m_descriptors.constFind(dir);
+        if (known != m_descriptors.cend() && m_watches.contains(*known)) {
+            m_watches[*known].indexes.insert(index);
+            return true;
+        }
+
+        const int wd = inotify_add_watch(m_fd, QFile::encodeName(dir).constData(), WatchMask);
+        if (wd < 0) {
+            if (errno == ENOSPC) {
+                if (!m_warned) {
+                    qWarning() << "Directory watch limit reached, raise fs.inotify.max_user_watches to watch:" << dir;
+                    m_warned = true;
+                }
+                m_limitReached = true;
+                if (!m_flushQueued.exchange(true)) {
+                    QMetaObject::invokeMethod(&m_flushTimer, qOverload<>(&QTimer::start), Qt::QueuedConnection);
+                }
+            }
+            return false;
+        }
+
+        // The same directory under another name (a symlink) shares the descriptor
+        Watch& watch = m_watches[wd];
+        if (watch.path.isEmpty()) {
+            watch.path = dir;
+        }
+        watch.indexes.insert(index);
+        m_descriptors.insert(dir, wd);
+        return true;
+    }
+
+    void DirectoryWatcher::unwatch(PathIndex* index) {
+        QMutexLocker currentLocker(&currentMutex);
+        DirectoryWatcher* watcher = current;
+        if (!watcher) {
+            return;
+        }
+
+        QMutexLocker locker(&watcher->m_mutex);
+        QList<int> unused;
+        for (auto it = watcher->m_watches.begin(); it != watcher->m_watches.end(); ++it) {
+            it->indexes.remove(index);
+            if (it->indexes.isEmpty()) {
+                unused.append(it.key());
+            }
+        }
+        for (const int wd : std::as_const(unused)) {
+            inotify_rm_watch(watcher->m_fd, wd);
+            watcher->removeWatch(wd);
+        }
+
+        // A later index may be allocated at the same address
+        watcher->m_changed.remove(index);
+        watcher->m_overflowed.remove(index);
+    }
+
+    void DirectoryWatcher::read() {
+        // Aligned for struct inotify_event, which the kernel packs back to back
+        alignas(inotify_event) char buffer[BufferSize];
+
+        pollfd fds[2] = { { m_fd, POLLIN, 0 }, { m_wakeFd, POLLIN, 0 } };
+        for (;;) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if (fds[1].revents != 0) {
+                return;
+            }
+
+            // Drain everything queued so far before handing it on
+            for (;;) {
+                const ssize_t length = ::read(m_fd, buffer, sizeof(buffer));
+                if (length <= 0) {
+                    break;
+                }
+                dispatch(buffer, length);
+            }
+        }
+    }
+
+    void DirectoryWatcher::dispatch(const char* buffer, qsizetype length) {
+        QMutexLocker locker(&m_mutex);
+
+        for (qsizetype offset = 0; offset + qsizetype(sizeof(inotify_event)) <= length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += qsizetype(sizeof(inotify_event)) + event->len;
+
+            // Events were dropped: nothing short of a new walk is reliable
+            if (event->mask & IN_Q_OVERFLOW) {
+                QSet<PathIndex*> indexes;
+                for (const Watch& watch : std::as_const(m_watches)) {
+                    indexes.unite(watch.indexes);
+                }
+                for (PathIndex* index : std::as_const(indexes)) {
+                    index->queueChange({ PathIndex::Change::Kind::Overflow, {}, {} });
+                    m_changed[index];
+                    m_overflowed.insert(index);
+                }
+                continue;
+            }
+
+            if (event->mask & IN_IGNORED) {
+                removeWatch(event->wd);
+                continue;
+            }
+
+            const auto it = m_watches.constFind(event->wd);
+            if (it == m_watches.cend() || event->len == 0) {
+                continue;
+            }
+
+            const QString name = QFile::decodeName(event->name);
+            const bool added = event->mask & (IN_CREATE | IN_MOVED_TO);
+            const PathIndex::Change change { added ? PathIndex::Change::Kind::Added : PathIndex::Change::Kind::Removed,
+                                             it->path, name };
+            const QString path = it->path + '/' + name;
+            for (PathIndex* index : it->indexes) {
+                index->queueChange(change);
+                m_changed[index].insert(path);
+            }
+
+            // A directory moved away keeps its watches under names that no longer
+            // exist; drop them, and a move within the tree watches it again
+            if ((event->mask & (IN_MOVED_FROM | IN_ISDIR)) == (IN_MOVED_FROM | IN_ISDIR)) {
+                const QString& moved = path;
+                QList<int> stale;
+                for (auto watch = m_watches.cbegin(); watch != m_watches.cend(); ++watch) {
+                    if (watch->path == moved || watch->path.startsWith(moved + '/')) {
+                        stale.append(watch.key());
+                    }
+                }
+                for (const int wd : std::as_const(stale)) {
+                    inotify_rm_watch(m_fd, wd);
+                    removeWatch(wd);
+                }
+            }
+        }
+
+        if (!m_changed.isEmpty() && !m_flushQueued.exchange(true)) {
+            QMetaObject::invokeMethod(&m_flushTimer, qOverload<>(&QTimer::start), Qt::QueuedConnection);
+        }
+    }
+
+    void DirectoryWatcher::removeWatch(int wd) {
+        const auto it = m_watches.find(wd);
+        if (it == m_watches.end()) {
+            return;
+        }
+
+        const auto descriptor = m_descriptors.constFind(it->path);
+        if (descriptor != m_descriptors.cend() && *descriptor == wd) {
+            m_descriptors.erase(descriptor);
+        }
+        m_watches.erase(it);
+    }
+
+    void DirectoryWatcher::flush() {
+        QHash<const PathIndex*, QSet<QString>> paths;
+        bool limitReached = false;
+        {
+            QMutexLocker locker(&m_mutex);
+            for (const PathIndex* index : std::as_const(m_overflowed)) {
+                m_changed[index].clear();
+            }
+            m_overflowed.clear();
+            paths.swap(m_changed);
+            limitReached = m_limitReached;
+            m_limitReached = false;
+            m_flushQueued = false;
+        }
+
+        if (!paths.isEmpty()) {
+            emit changed(paths);
+        }
+        if (limitReached) {
+            emit watchLimitReached();
+        }
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThread>
+#include <QTimer>
+#include <atomic>
+
+namespace quicksearch::models {
+
+    class PathIndex;
+
+    // Watches the directories of every shared PathIndex through one inotify
+    // instance, read in bulk on a thread of its own.
+    //
+    // Entries created, deleted or moved are handed to the indexes watching
+    // the directory as they are read, so an index applies exactly those
+    // changes instead of re-listing anything. Each directory is watched once
+    // however many indexes contain it. The indexes that changed are reported
+    // on the GUI thread at most once a frame, so a burst such as an archive
+    // being extracted becomes one update.
+    //
+    // Watches count against fs.inotify.max_user_watches; when that runs out,
+    // the directories that couldn't be watched are reported through
+    // watchLimitReached() and the indexes' isFullyWatched().
+    //
+    // instance() must first be called on the GUI thread; FileSystemModel does.
+    class DirectoryWatcher : public QObject {
+        Q_OBJECT
+
+    public:
+        static DirectoryWatcher* instance();
+
+        ~DirectoryWatcher() override;
+
+        // Starts reporting changes to dir's entries to index. Returns false
+        // if the directory couldn't be watched. Safe from any thread.
+        bool watch(PathIndex* index, const QString& dir);
+
+        // Stops reporting anything to index, including changes not yet
+        // reported. Safe from any thread, and after the watcher is destroyed.
+        static void unwatch(PathIndex* index);
+
+    signals:
+        // Paths that appeared or disappeared since the last time, per index
+        // (only compare the pointers). An empty set means anything may have
+        // changed, after the kernel dropped events.
+        void changed(const QHash<const PathIndex*, QSet<QString>>& paths);
+        void watchLimitReached();
+
+    private:
+        struct Watch {
+            QString path;
+            QSet<PathIndex*> indexes;
+        };
+
+        explicit DirectoryWatcher(QObject* parent = nullptr);
+
+        int m_fd;
+        int m_wakeFd; // eventfd that stops the reader
+        QThread* m_reader;
+
+        QMutex m_mutex;
+        QHash<int, Watch> m_watches; // watch descriptor -> directory
+        QHash<QString, int> m_descriptors;
+        QHash<const PathIndex*, QSet<QString>> m_changed;
+        QSet<const PathIndex*> m_overflowed;
+        bool m_limitReached;
+        bool m_warned;
+
+        std::atomic_bool m_flushQueued;
+        QTimer m_flushTimer;
+
+        void read();
+        void dispatch(const char* buffer, qsizetype length);
+        void removeWatch(int wd);
+        void flush();
+    };
+
+} // namespace quicksearch::models
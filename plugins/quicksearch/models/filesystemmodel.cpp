@@ -2,29 +2,61 @@
 // Original work by soramane, caelestia-dots/shell, licensed under GPL-3.0, thank you for your hard work!
 
 #include "filesystemmodel.hpp"
+#include "appcatalog.hpp"
+#include "directorywatcher.hpp"
+#include "frecencystore.hpp"
 #include "fuzzysearch.hpp"
+#include "iconresolver.hpp"
+#include "imageprobe.hpp"
+#include "thumbnailprovider.hpp"
 
-#include <qcryptographichash.h>
-#include <qdiriterator.h>
 #include <qfuturewatcher.h>
-#include <qprocess.h>
+#include <qreadwritelock.h>
+#include <qregularexpression.h>
 #include <qtconcurrentrun.h>
+#include <functional>
 
 namespace quicksearch::models {
 
+    namespace {
+
+        // Typo-tolerant fallback, run only once exact matching found fewer than
+        // the threshold: adds the closest of the candidates it rejected first.
+        // accept() returns a candidate's path, or an empty string if it isn't
+        // wanted after all, so files are only opened for near misses that get this far.
+        void addTypoMatches(QSet<QString>& paths, QList<QPair<int, qsizetype>>& typoMatches, int maxResults,
+                            const std::function<QString(qsizetype)>& accept) {
+            std::stable_sort(typoMatches.begin(), typoMatches.end(), [](const auto& a, const auto& b) {
+                return a.first < b.first;
+            });
+
+            for (const auto& match : std::as_const(typoMatches)) {
+                if (maxResults > 0 && paths.size() >= maxResults) {
+                    break;
+                }
+                const QString path = accept(match.second);
+                if (!path.isEmpty()) {
+                    paths.insert(path);
+                }
+            }
+        }
+
+        // More changed paths than this at once are cheaper to handle with a full query
+        constexpr qsizetype MaxScopedPaths = 256;
+
+        QString parentOf(const QString& path) {
+            return path.left(path.lastIndexOf('/'));
+        }
+
+    } // namespace
+
     FileSystemEntry::FileSystemEntry(const QString& path, const QString& relativePath, QObject* parent)
     : QObject(parent)
     , m_fileInfo(path)
     , m_path(path)
     , m_relativePath(relativePath)
-    , m_isImageInitialised(false)
-    , m_imageThumbnailInitialised(false)
-    , m_isVideoInitialised(false)
-    , m_videoThumbnailInitialised(false)
-    , m_isMusicInitialised(false)
-    , m_musicThumbnailInitialised(false)
-    , m_mimeTypeInitialised(false)
-    , m_desktopDataInitialised(false) {}
+    , m_desktopDataInitialised(false)
+    , m_actionsInitialised(false) {}
 
     QString FileSystemEntry::path() const {
         return m_path;
@@ -59,309 +91,64 @@ namespace quicksearch::models {
     };
 
     bool FileSystemEntry::isImage() const {
-        if (!m_isImageInitialised) {
-            QImageReader reader(m_path);
-            m_isImage = reader.canRead();
-            m_isImageInitialised = true;
-        }
-        return m_isImage;
+        return imageInfo().isImage();
     }
 
-    QString FileSystemEntry::imageThumbnail() const {
-        if (!m_imageThumbnailInitialised) {
-            m_imageThumbnailInitialised = true;
-
-            // Only generate thumbnails for image files
-            if (!isImage()) {
-                m_imageThumbnail = QString();
-                return m_imageThumbnail;
-            }
-
-            // Generate cache directory path
-            const QString cacheDir = QDir::homePath() + "/.cache/unite/image-thumbnails";
-            QDir().mkpath(cacheDir);
-
-            // Generate unique filename based on image path and modification time
-            QCryptographicHash hash(QCryptographicHash::Sha256);
-            hash.addData(m_path.toUtf8());
-            hash.addData(QString::number(m_fileInfo.lastModified().toMSecsSinceEpoch()).toUtf8());
-            const QString hashStr = QString(hash.result().toHex());
-            const QString thumbnailPath = cacheDir + "/" + hashStr + ".png";
-
-            // Check if thumbnail already exists
-            if (QFileInfo::exists(thumbnailPath)) {
-                m_imageThumbnail = thumbnailPath;
-                return m_imageThumbnail;
-            }
-
-            // Load the original image
-            QImage image(m_path);
-            if (image.isNull()) {
-                m_imageThumbnail = QString();
-                return m_imageThumbnail;
-            }
-
-            // Scale image to 512px max dimension while preserving aspect ratio
-            const int maxSize = 512;
-            QImage thumbnail;
-            if (image.width() > maxSize || image.height() > maxSize) {
-                thumbnail = image.scaled(maxSize, maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-            } else {
-                // If image is already small, just use it as-is
-                thumbnail = image;
-            }
-
-            // Save the thumbnail as PNG to preserve transparency
-            if (thumbnail.save(thumbnailPath, "PNG")) {
-                m_imageThumbnail = thumbnailPath;
-            } else {
-                // If saving fails, return the original path
-                m_imageThumbnail = m_path;
-            }
-        }
-        return m_imageThumbnail;
+    QSize FileSystemEntry::imageSize() const {
+        return imageInfo().orientedSize();
     }
 
-    bool FileSystemEntry::isVideo() const {
-        if (!m_isVideoInitialised) {
-            // Check MIME type to determine if it's a video
-            const QMimeDatabase db;
-            const QString mime = db.mimeTypeForFile(m_path).name();
-            m_isVideo = mime.startsWith("video/");
-            m_isVideoInitialised = true;
-        }
-        return m_isVideo;
+    int FileSystemEntry::imageOrientation() const {
+        return imageInfo().orientation;
     }
 
-    QString FileSystemEntry::videoThumbnail() const {
-        if (!m_videoThumbnailInitialised) {
-            m_videoThumbnailInitialised = true;
-
-            // Only generate thumbnails for video files
-            if (!isVideo()) {
-                m_videoThumbnail = QString();
-                return m_videoThumbnail;
-            }
-
-            // Generate cache directory path
-            const QString cacheDir = QDir::homePath() + "/.cache/unite/video-thumbnails";
-            QDir().mkpath(cacheDir);
-
-            // Generate unique filename based on video path
-            QCryptographicHash hash(QCryptographicHash::Sha256);
-            hash.addData(m_path.toUtf8());
-            const QString hashStr = QString(hash.result().toHex());
-            const QString thumbnailPath = cacheDir + "/" + hashStr + ".jpg";
-
-            // Check if thumbnail already exists and is not mostly black
-            if (QFileInfo::exists(thumbnailPath)) {
-                QImage existingImage(thumbnailPath);
-                if (!existingImage.isNull() && !isMostlyBlack(existingImage)) {
-                    m_videoThumbnail = thumbnailPath;
-                    return m_videoThumbnail;
-                }
-                // If existing thumbnail is mostly black, delete it and regenerate
-                QFile::remove(thumbnailPath);
-            }
-
-            // Try different timestamps to avoid black frames
-            QStringList timestamps = {"10%", "20%", "30%", "5%"};
-
-            // Try to generate thumbnail using ffmpegthumbnailer first
-            for (const QString& timestamp : timestamps) {
-                QProcess ffmpegthumbnailer;
-                ffmpegthumbnailer.start("ffmpegthumbnailer", QStringList()
-                    << "-i" << m_path
-                    << "-o" << thumbnailPath
-                    << "-s" << "512"
-                    << "-t" << timestamp);
-
-                if (ffmpegthumbnailer.waitForFinished(5000) && ffmpegthumbnailer.exitCode() == 0) {
-                    // Check if the generated thumbnail is mostly black
-                    QImage thumbnail(thumbnailPath);
-                    if (!thumbnail.isNull() && !isMostlyBlack(thumbnail)) {
-                        m_videoThumbnail = thumbnailPath;
-                        return m_videoThumbnail;
-                    }
-                    // If mostly black, try next timestamp
-                    QFile::remove(thumbnailPath);
-                }
-            }
-
-            // Fallback to ffmpeg if ffmpegthumbnailer is not available or all attempts failed
-            QStringList ffmpegTimestamps = {"00:00:03", "00:00:05", "00:00:10", "00:00:01"};
-            for (const QString& timestamp : ffmpegTimestamps) {
-                QProcess ffmpeg;
-                ffmpeg.start("ffmpeg", QStringList()
-                    << "-ss" << timestamp
-                    << "-i" << m_path
-                    << "-vframes" << "1"
-                    << "-vf" << "scale=512:-1"
-                    << thumbnailPath
-                    << "-y");
-
-                if (ffmpeg.waitForFinished(5000) && ffmpeg.exitCode() == 0) {
-                    // Check if the generated thumbnail is mostly black
-                    QImage thumbnail(thumbnailPath);
-                    if (!thumbnail.isNull() && !isMostlyBlack(thumbnail)) {
-                        m_videoThumbnail = thumbnailPath;
-                        return m_videoThumbnail;
-                    }
-                    // If mostly black, try next timestamp
-                    QFile::remove(thumbnailPath);
-                }
-            }
-
-            // If all attempts fail, return empty string
-            m_videoThumbnail = QString();
-        }
-        return m_videoThumbnail;
+    void FileSystemEntry::setImageInfo(const ImageInfo& info) {
+        m_imageInfo = info;
     }
 
-    bool FileSystemEntry::isMostlyBlack(const QImage& image) const {
-        if (image.isNull() || image.width() == 0 || image.height() == 0) {
-            return true;
+    const ImageInfo& FileSystemEntry::imageInfo() const {
+        // Only entries the worker didn't probe get here; most aren't named like images
+        if (!m_imageInfo) {
+            m_imageInfo = ImageProbe::probe(m_path);
         }
+        return *m_imageInfo;
+    }
 
-        // Sample pixels to check if image is mostly black
-        // We don't need to check every pixel - sampling is faster
-        const int sampleRate = 8; // Check every 8th pixel
-        int blackPixels = 0;
-        int totalSamples = 0;
-
-        for (int y = 0; y < image.height(); y += sampleRate) {
-            for (int x = 0; x < image.width(); x += sampleRate) {
-                QColor pixel = image.pixelColor(x, y);
-                totalSamples++;
-
-                // Consider a pixel "black" if its brightness is very low
-                // Calculate brightness as average of RGB
-                int brightness = (pixel.red() + pixel.green() + pixel.blue()) / 3;
+    QString FileSystemEntry::imageThumbnail() const {
+        // Generated off the GUI thread by the image provider on first display
+        return isImage() ? ThumbnailProvider::source(Thumbnailer::Kind::Image, m_path) : QString();
+    }
 
-                if (brightness < 25) { // Very dark threshold (0-255 scale)
-                    blackPixels++;
-                }
-            }
-        }
+    bool FileSystemEntry::isVideo() const {
+        return fileType().category() == FileType::Category::Video;
+    }
 
-        // Return true if more than 50% of sampled pixels are black
-        return totalSamples > 0 && (static_cast<double>(blackPixels) / totalSamples) > 0.5;
+    QString FileSystemEntry::videoThumbnail() const {
+        return isVideo() ? ThumbnailProvider::source(Thumbnailer::Kind::Video, m_path) : QString();
     }
 
     bool FileSystemEntry::isMusic() const {
-        if (!m_isMusicInitialised) {
-            // Check MIME type to determine if it's an audio file
-            const QMimeDatabase db;
-            const QString mime = db.mimeTypeForFile(m_path).name();
-            m_isMusic = mime.startsWith("audio/");
-            m_isMusicInitialised = true;
-        }
-        return m_isMusic;
+        return fileType().category() == FileType::Category::Audio;
     }
 
     QString FileSystemEntry::musicThumbnail() const {
-        if (!m_musicThumbnailInitialised) {
-            m_musicThumbnailInitialised = true;
-
-            // Only generate thumbnails for music files
-            if (!isMusic()) {
-                m_musicThumbnail = QString();
-                return m_musicThumbnail;
-            }
-
-            // Generate cache directory path
-            const QString cacheDir = QDir::homePath() + "/.cache/unite/music-thumbnails";
-            QDir().mkpath(cacheDir);
-
-            // Generate unique filename based on music file path
-            QCryptographicHash hash(QCryptographicHash::Sha256);
-            hash.addData(m_path.toUtf8());
-            const QString hashStr = QString(hash.result().toHex());
-            const QString thumbnailPath = cacheDir + "/" + hashStr + ".jpg";
-
-            // Check if thumbnail already exists in cache
-            if (QFileInfo::exists(thumbnailPath)) {
-                m_musicThumbnail = thumbnailPath;
-                return m_musicThumbnail;
-            }
-
-            // Try to extract embedded album art using ffmpeg
-            QProcess ffmpeg;
-            ffmpeg.start("ffmpeg", QStringList()
-                << "-i" << m_path
-                << "-an"  // Disable audio
-                << "-vcodec" << "copy"  // Copy video stream (album art)
-                << thumbnailPath
-                << "-y");
-
-            if (ffmpeg.waitForFinished(5000) && ffmpeg.exitCode() == 0 && QFileInfo::exists(thumbnailPath)) {
-                // Successfully extracted embedded art
-                m_musicThumbnail = thumbnailPath;
-                return m_musicThumbnail;
-            }
-
-            // If no embedded art, look for folder.* in the same directory
-            const QDir musicDir = m_fileInfo.absoluteDir();
-            const QStringList imageExtensions = {"jpg", "jpeg", "png", "gif", "bmp", "webp"};
-
-            for (const QString& ext : imageExtensions) {
-                const QString folderImagePath = musicDir.filePath("folder." + ext);
-                if (QFileInfo::exists(folderImagePath)) {
-                    // Found a folder image, create a cached copy
-                    QImage folderImage(folderImagePath);
-                    if (!folderImage.isNull()) {
-                        // Scale to 512px and save to cache
-                        const int maxSize = 512;
-                        QImage thumbnail;
-                        if (folderImage.width() > maxSize || folderImage.height() > maxSize) {
-                            thumbnail = folderImage.scaled(maxSize, maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                        } else {
-                            thumbnail = folderImage;
-                        }
-
-                        if (thumbnail.save(thumbnailPath, "JPG", 85)) {
-                            m_musicThumbnail = thumbnailPath;
-                            return m_musicThumbnail;
-                        }
-                    }
-                }
-            }
-
-            // Also check for uppercase extensions
-            for (const QString& ext : imageExtensions) {
-                const QString folderImagePath = musicDir.filePath("folder." + ext.toUpper());
-                if (QFileInfo::exists(folderImagePath)) {
-                    QImage folderImage(folderImagePath);
-                    if (!folderImage.isNull()) {
-                        const int maxSize = 512;
-                        QImage thumbnail;
-                        if (folderImage.width() > maxSize || folderImage.height() > maxSize) {
-                            thumbnail = folderImage.scaled(maxSize, maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-                        } else {
-                            thumbnail = folderImage;
-                        }
+        return isMusic() ? ThumbnailProvider::source(Thumbnailer::Kind::Music, m_path) : QString();
+    }
 
-                        if (thumbnail.save(thumbnailPath, "JPG", 85)) {
-                            m_musicThumbnail = thumbnailPath;
-                            return m_musicThumbnail;
-                        }
-                    }
-                }
-            }
+    QString FileSystemEntry::mimeType() const {
+        return fileType().mimeType();
+    }
 
-            // No thumbnail found
-            m_musicThumbnail = QString();
-        }
-        return m_musicThumbnail;
+    void FileSystemEntry::setFileType(FileType type) {
+        m_fileType = type;
     }
 
-    QString FileSystemEntry::mimeType() const {
-        if (!m_mimeTypeInitialised) {
-            const QMimeDatabase db;
-            m_mimeType = db.mimeTypeForFile(m_path).name();
-            m_mimeTypeInitialised = true;
+    FileType FileSystemEntry::fileType() const {
+        // Only entries the worker didn't classify get here
+        if (!m_fileType.isResolved()) {
+            m_fileType = FileType::classify(m_path, m_fileInfo.isDir());
         }
-        return m_mimeType;
+        return m_fileType;
     }
 
     void FileSystemEntry::ensureDesktopDataLoaded() const {
@@ -371,116 +158,160 @@ namespace quicksearch::models {
 
         m_desktopDataInitialised = true;
 
-        if (m_fileInfo.suffix() == "desktop") {
-            m_desktopData = DesktopEntryParser::parse(m_path);
+        if (m_fileInfo.suffix() != "desktop") {
+            return;
+        }
+
+        // Applications come from the shared catalog; only parse files it doesn't know
+        m_desktopData = AppCatalog::instance()->find(m_path);
+        if (!m_desktopData) {
+            if (auto parsed = DesktopEntryParser::parse(m_path)) {
+                m_desktopData = std::make_shared<const DesktopEntryData>(std::move(*parsed));
+            }
         }
     }
 
     bool FileSystemEntry::isDesktopEntry() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value();
+        return m_desktopData != nullptr;
     }
 
     QString FileSystemEntry::name() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->name : QString();
+        return m_desktopData ? m_desktopData->name : QString();
     }
 
     QString FileSystemEntry::genericName() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->genericName : QString();
+        return m_desktopData ? m_desktopData->genericName : QString();
     }
 
     QString FileSystemEntry::comment() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->comment : QString();
+        return m_desktopData ? m_desktopData->comment : QString();
     }
 
     QString FileSystemEntry::icon() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->icon : QString();
+        return m_desktopData ? m_desktopData->icon : QString();
+    }
+
+    QString FileSystemEntry::iconPath() const {
+        const QString iconName = icon();
+        if (iconName.isEmpty()) {
+            return QString();
+        }
+
+        // Resolved from the shared icon index; re-read once it has been built
+        auto* resolver = IconResolver::instance();
+        if (!resolver->isReady()) {
+            connect(resolver, &IconResolver::ready, this, &FileSystemEntry::iconPathChanged, Qt::UniqueConnection);
+            return QString();
+        }
+        return resolver->resolve(iconName);
     }
 
     QStringList FileSystemEntry::command() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->command : QStringList();
+        return m_desktopData ? DesktopEntryParser::parseExecString(m_desktopData->execString) : QStringList();
     }
 
     QString FileSystemEntry::execString() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->execString : QString();
+        return m_desktopData ? m_desktopData->execString : QString();
     }
 
     QStringList FileSystemEntry::categories() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->categories : QStringList();
+        return m_desktopData ? m_desktopData->categories : QStringList();
     }
 
     QStringList FileSystemEntry::keywords() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->keywords : QStringList();
+        return m_desktopData ? m_desktopData->keywords : QStringList();
     }
 
     QQmlListProperty<DesktopAction> FileSystemEntry::actions() const {
         ensureDesktopDataLoaded();
-        if (m_desktopData.has_value()) {
-            return QQmlListProperty<DesktopAction>(
-                const_cast<FileSystemEntry*>(this),
-                const_cast<QList<DesktopAction*>*>(&m_desktopData->actions)
-            );
+        if (!m_actionsInitialised) {
+            m_actionsInitialised = true;
+            if (m_desktopData) {
+                auto* self = const_cast<FileSystemEntry*>(this);
+                const LaunchRequest app = Launcher::requestFor(m_path, *m_desktopData);
+                for (const DesktopActionSpec& spec : m_desktopData->actions) {
+                    m_actions.append(new DesktopAction(spec, app, self));
+                }
+            }
         }
-        static QList<DesktopAction*> empty;
+
         return QQmlListProperty<DesktopAction>(
             const_cast<FileSystemEntry*>(this),
-            &empty
+            &m_actions
         );
     }
 
     QString FileSystemEntry::desktopId() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->id : QString();
+        return m_desktopData ? m_desktopData->id : QString();
     }
 
     bool FileSystemEntry::noDisplay() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->noDisplay : false;
+        return m_desktopData ? m_desktopData->noDisplay : false;
     }
 
     bool FileSystemEntry::runInTerminal() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->runInTerminal : false;
+        return m_desktopData ? m_desktopData->runInTerminal : false;
     }
 
     QString FileSystemEntry::workingDirectory() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->workingDirectory : QString();
+        return m_desktopData ? m_desktopData->workingDirectory : QString();
     }
 
     QString FileSystemEntry::startupClass() const {
         ensureDesktopDataLoaded();
-        return m_desktopData.has_value() ? m_desktopData->startupClass : QString();
+        return m_desktopData ? m_desktopData->startupClass : QString();
     }
 
     void FileSystemEntry::execute() {
+        execute(QList<QUrl>());
+    }
+
+    void FileSystemEntry::execute(const QList<QUrl>& urls) {
         ensureDesktopDataLoaded();
 
-        if (!m_desktopData.has_value()) {
+        if (!m_desktopData) {
             qWarning() << "Cannot execute: not a desktop entry:" << m_path;
             return;
         }
 
-        const QStringList& cmd = m_desktopData->command;
-        if (cmd.isEmpty()) {
+        if (DesktopEntryParser::parseExecString(m_desktopData->execString).isEmpty()) {
             qWarning() << "Cannot execute: empty command:" << m_path;
             return;
         }
 
-        const QString& workDir = m_desktopData->workingDirectory;
+        // Spawned off the GUI thread; see Launcher
+        LaunchRequest request = Launcher::requestFor(m_path, *m_desktopData);
+        request.urls = urls;
+        Launcher::instance()->launch(request);
 
-        // Execute the command detached (like Quickshell.execDetached)
-        if (!QProcess::startDetached(cmd[0], cmd.mid(1), workDir.isEmpty() ? QDir::homePath() : workDir)) {
-            qWarning() << "Failed to execute:" << cmd.join(" ");
-        }
+        FrecencyStore::instance()->record(usageKey());
+    }
+
+    void FileSystemEntry::open() {
+        LaunchRequest request;
+        request.exec = "xdg-open %u";
+        request.workingDirectory = parentDir();
+        request.urls << QUrl::fromLocalFile(m_path);
+        Launcher::instance()->launch(request);
+
+        FrecencyStore::instance()->record(usageKey());
+    }
+
+    QString FileSystemEntry::usageKey() const {
+        return isDesktopEntry() ? desktopId() : m_path;
     }
 
     void FileSystemEntry::updateRelativePath(const QDir& dir) {
@@ -495,6 +326,7 @@ namespace quicksearch::models {
     : QAbstractListModel(parent)
     , m_recursive(false)
     , m_watchChanges(true)
+    , m_watchLimitReached(false)
     , m_showHidden(false)
     , m_sort(true)
     , m_sortProperty("relativePath")
@@ -502,9 +334,14 @@ namespace quicksearch::models {
     , m_minScore(0.3)
     , m_maxDepth(-1)
     , m_maxResults(-1)
-    , m_taskGeneration(0) {
-        connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &FileSystemModel::watchDirIfRecursive);
-        connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &FileSystemModel::updateEntriesForDir);
+    , m_typoTolerance(0)
+    , m_typoThreshold(5)
+    , m_taskGeneration(0)
+    , m_scopeTask(0) {
+        // Also makes sure the watcher is created on the GUI thread
+        connect(DirectoryWatcher::instance(), &DirectoryWatcher::changed, this, &FileSystemModel::onIndexesChanged);
+        connect(DirectoryWatcher::instance(), &DirectoryWatcher::watchLimitReached, this,
+                &FileSystemModel::updateWatchLimitReached);
     }
 
     int FileSystemModel::rowCount(const QModelIndex& parent) const {
@@ -578,6 +415,10 @@ namespace quicksearch::models {
         update();
     }
 
+    bool FileSystemModel::watchLimitReached() const {
+        return m_watchLimitReached;
+    }
+
     bool FileSystemModel::showHidden() const {
         return m_showHidden;
     }
@@ -698,14 +539,14 @@ namespace quicksearch::models {
         m_query = query;
         ++m_taskGeneration;
         m_scoreCache.clear();
+        m_boostCache.clear();
         emit queryChanged();
 
         // Clear existing entries to force a full refresh
         // This ensures proper sorting after query changes
         if (!m_entries.isEmpty()) {
             beginResetModel();
-            qDeleteAll(m_entries);
-            m_entries.clear();
+            clearEntries();
             endResetModel();
         }
 
@@ -760,6 +601,40 @@ namespace quicksearch::models {
         update();
     }
 
+    int FileSystemModel::typoTolerance() const {
+        return m_typoTolerance;
+    }
+
+    void FileSystemModel::setTypoTolerance(int typoTolerance) {
+        // Anything beyond two edits matches too much to be useful
+        typoTolerance = qBound(0, typoTolerance, 2);
+        if (m_typoTolerance == typoTolerance) {
+            return;
+        }
+
+        m_typoTolerance = typoTolerance;
+        ++m_taskGeneration;
+        emit typoToleranceChanged();
+
+        update();
+    }
+
+    int FileSystemModel::typoThreshold() const {
+        return m_typoThreshold;
+    }
+
+    void FileSystemModel::setTypoThreshold(int typoThreshold) {
+        if (m_typoThreshold == typoThreshold) {
+            return;
+        }
+
+        m_typoThreshold = typoThreshold;
+        ++m_taskGeneration;
+        emit typoThresholdChanged();
+
+        update();
+    }
+
     QQmlListProperty<FileSystemEntry> FileSystemModel::entries() {
         return QQmlListProperty<FileSystemEntry>(this, &m_entries);
     }
@@ -787,60 +662,114 @@ namespace quicksearch::models {
         return result;
     }
 
-    void FileSystemModel::watchDirIfRecursive(const QString& path) {
-        if (m_recursive && m_watchChanges) {
-            const auto currentDir = m_dir;
-            const bool showHidden = m_showHidden;
-            const auto future = QtConcurrent::run([showHidden, path]() {
-                QDir::Filters filters = QDir::Dirs | QDir::NoDotAndDotDot;
-                if (showHidden) {
-                    filters |= QDir::Hidden;
-                }
+    void FileSystemModel::prefetch(int start, int count, int size) {
+        QList<ThumbnailPrefetcher::Item> items;
 
-                QDirIterator iter(path, filters, QDirIterator::Subdirectories);
-                QStringList dirs;
-                while (iter.hasNext()) {
-                    dirs << iter.next();
-                }
-                return dirs;
-            });
-            const auto watcher = new QFutureWatcher<QStringList>(this);
-            connect(watcher, &QFutureWatcher<QStringList>::finished, this, [currentDir, showHidden, watcher, this]() {
-                const auto paths = watcher->result();
-                if (currentDir == m_dir && showHidden == m_showHidden && !paths.isEmpty()) {
-                    // Ignore if dir or showHidden has changed
-                    m_watcher.addPaths(paths);
+        const int end = qMin(start + qMax(count, 0), static_cast<int>(m_entries.size()));
+        for (int i = qMax(start, 0); i < end; ++i) {
+            const FileSystemEntry* entry = m_entries.at(i);
+            if (entry->isImage()) {
+                items.append({ Thumbnailer::Kind::Image, entry->path() });
+            } else if (entry->isVideo()) {
+                items.append({ Thumbnailer::Kind::Video, entry->path() });
+            } else if (entry->isMusic()) {
+                items.append({ Thumbnailer::Kind::Music, entry->path() });
+            }
+        }
+
+        m_prefetcher.setWindow(items, size);
+    }
+
+    void FileSystemModel::onIndexesChanged(const QHash<const PathIndex*, QSet<QString>>& paths) {
+        if (!m_watchChanges || m_filter == Applications || !m_index) {
+            return;
+        }
+        const auto changed = paths.constFind(m_index.get());
+        if (changed == paths.cend()) {
+            return;
+        }
+
+        // The index has the changes queued; the query applies them on the worker.
+        // Usually only the changed paths need looking at, unless a full query is
+        // already on its way (it may have read the index before these changes).
+        const bool fullRunning = m_scope.isEmpty() && m_futures.contains(m_path);
+        if (changed->isEmpty() || fullRunning || !canUpdateInScope() ||
+            m_scope.size() + changed->size() > MaxScopedPaths) {
+            updateEntriesForDir(m_path);
+            return;
+        }
+
+        m_scope.unite(*changed);
+        updateEntriesForDir(m_path, m_scope);
+    }
+
+    bool FileSystemModel::canUpdateInScope() const {
+        // Rows cut off by maxResults, or near misses standing in for matches,
+        // depend on everything else in the index
+        const int rows = static_cast<int>(m_entries.size());
+        if (m_maxResults > 0 && rows >= m_maxResults) {
+            return false;
+        }
+        return m_query.isEmpty() || m_typoTolerance <= 0 || rows >= m_typoThreshold;
+    }
+
+    QSet<QString> FileSystemModel::rowsInScope(const QSet<QString>& scope) const {
+        QSet<QString> rows;
+        for (const auto& path : scope) {
+            const auto siblings = m_rowsByDir.constFind(parentOf(path));
+            if (siblings != m_rowsByDir.cend() && siblings->contains(path)) {
+                rows.insert(path);
+            }
+
+            // If it is or was a directory, its rows go with it: those directly in
+            // it, then its subdirectories, which sort right after the prefix
+            const auto addRows = [&rows](const QHash<QString, FileSystemEntry*>& dirRows) {
+                for (auto row = dirRows.cbegin(); row != dirRows.cend(); ++row) {
+                    rows.insert(row.key());
                 }
-                watcher->deleteLater();
-            });
-            watcher->setFuture(future);
+            };
+            const auto inside = m_rowsByDir.constFind(path);
+            if (inside != m_rowsByDir.cend()) {
+                addRows(*inside);
+            }
+            const QString prefix = path + '/';
+            for (auto it = m_rowsByDir.lowerBound(prefix); it != m_rowsByDir.cend() && it.key().startsWith(prefix); ++it) {
+                addRows(it.value());
+            }
         }
+        return rows;
     }
 
-    void FileSystemModel::update() {
-        updateWatcher();
-        updateEntries();
+    void FileSystemModel::clearEntries() {
+        qDeleteAll(m_entries);
+        m_entries.clear();
+        m_rowsByDir.clear();
     }
 
-    void FileSystemModel::updateWatcher() {
-        if (!m_watcher.directories().isEmpty()) {
-            m_watcher.removePaths(m_watcher.directories());
+    void FileSystemModel::updateWatchLimitReached() {
+        const bool reached = m_watchChanges && m_filter != Applications && m_index && !m_index->isFullyWatched();
+        if (m_watchLimitReached != reached) {
+            m_watchLimitReached = reached;
+            emit watchLimitReachedChanged();
         }
+    }
 
-        if (!m_watchChanges || m_path.isEmpty()) {
-            return;
+    void FileSystemModel::onCatalogChanged() {
+        if (m_filter == Applications) {
+            updateEntries();
         }
+    }
 
-        m_watcher.addPath(m_path);
-        watchDirIfRecursive(m_path);
+    void FileSystemModel::update() {
+        updateEntries();
+        updateWatchLimitReached();
     }
 
     void FileSystemModel::updateEntries() {
         if (m_path.isEmpty() && m_filter != Applications) {
             if (!m_entries.isEmpty()) {
                 beginResetModel();
-                qDeleteAll(m_entries);
-                m_entries.clear();
+                clearEntries();
                 endResetModel();
                 emit entriesChanged();
                 emit lengthChanged();
@@ -854,191 +783,410 @@ namespace quicksearch::models {
         }
         m_futures.clear();
 
+        if (m_filter != Applications) {
+            const PathIndex::Options options { m_path, m_recursive, m_showHidden, m_maxDepth };
+            // Without a watcher nothing keeps the index fresh, so walk again every time
+            if (!m_index || m_index->options() != options || !m_watchChanges) {
+                m_index = m_watchChanges ? PathIndex::shared(options) : std::make_shared<PathIndex>(options);
+            }
+        }
+
+        if (m_filter == Applications) {
+            // Created here so the catalog lives on the GUI thread
+            connect(AppCatalog::instance(), &AppCatalog::changed, this, &FileSystemModel::onCatalogChanged, Qt::UniqueConnection);
+        }
+
         // For Applications filter, use empty string as dir (will be ignored anyway)
         updateEntriesForDir(m_filter == Applications ? QString() : m_path);
     }
 
-    void FileSystemModel::updateEntriesForDir(const QString& dir) {
+    void FileSystemModel::updateEntriesForDir(const QString& dir, const QSet<QString>& scope) {
         // Capture generation number FIRST to validate results before applying
         const auto taskGeneration = m_taskGeneration;
-        const auto recursive = m_recursive;
+        const auto scopeTask = ++m_scopeTask;
         const auto showHidden = m_showHidden;
         const auto filter = m_filter;
         const auto nameFilters = m_nameFilters;
         const auto query = m_query;
         const auto minScore = m_minScore;
-        const auto maxDepth = m_maxDepth;
         const auto maxResults = m_maxResults;
+        const auto typoTolerance = m_typoTolerance;
+        const auto typoThreshold = m_typoThreshold;
+        const auto index = m_index;
 
+        // A scoped update diffs only against the rows inside its scope, and may
+        // add as many as maxResults leaves room for next to the rows outside it
         QSet<QString> oldPaths;
-        for (const auto& entry : std::as_const(m_entries)) {
-            oldPaths << entry->path();
+        int limit = maxResults;
+        qsizetype outsideRows = 0;
+        if (scope.isEmpty()) {
+            m_scope.clear();
+            for (const auto& entry : std::as_const(m_entries)) {
+                oldPaths << entry->path();
+            }
+        } else {
+            oldPaths = rowsInScope(scope);
+            outsideRows = m_entries.size() - oldPaths.size();
+            if (maxResults > 0) {
+                limit = maxResults - static_cast<int>(outsideRows);
+            }
         }
 
-        const auto future = QtConcurrent::run([=](QPromise<QPair<QSet<QString>, QSet<QString>>>& promise) {
-            // Handle Applications filter separately
+        const auto future = QtConcurrent::run([=](QPromise<FileSystemChanges>& promise) {
+            // Handle Applications filter separately: query the shared in-memory catalog
             if (filter == Applications) {
-                // Get XDG directories
-                QStringList xdgDirs = DesktopEntryParser::resolveXdgDataDirs();
+                const auto catalog = AppCatalog::instance()->snapshot();
                 QSet<QString> newPaths;
-                QMap<QString, QString> seenApps; // basename -> path (deduplication)
-
-                // Iterate through each XDG directory
-                for (const QString& xdgDir : xdgDirs) {
-                    QDirIterator appIter(xdgDir, QStringList() << "*.desktop", QDir::Files);
+                QList<qsizetype> rejected; // apps the exact matcher turned down
 
-                    while (appIter.hasNext()) {
-                        if (promise.isCanceled()) {
-                            return;
-                        }
-
-                        QString path = appIter.next();
-                        QString basename = QFileInfo(path).fileName();
-
-                        // Deduplication: prefer first (higher priority)
-                        if (seenApps.contains(basename)) {
-                            continue;
-                        }
-                        seenApps[basename] = path;
+                for (qsizetype i = 0; i < catalog->apps.size(); ++i) {
+                    if (promise.isCanceled()) {
+                        return;
+                    }
 
-                        // Parse desktop file
-                        auto desktopData = DesktopEntryParser::parse(path);
-                        if (!desktopData.has_value()) {
-                            continue;
-                        }
+                    const auto& app = catalog->apps.at(i);
 
-                        // Honor NoDisplay (unless showHidden)
-                        if (desktopData->noDisplay && !showHidden) {
-                            continue;
-                        }
+                    // Honor NoDisplay (unless showHidden)
+                    if (app.data->noDisplay && !showHidden) {
+                        continue;
+                    }
 
-                        // Fuzzy search across multiple fields
-                        if (!query.isEmpty()) {
-                            QString searchText = desktopData->name + " " +
-                                               desktopData->genericName + " " +
-                                               desktopData->comment + " " +
-                                               desktopData->keywords.join(' ');
-                            FuzzyMatch match = FuzzySearch::match(query, searchText);
-                            if (!match.isMatch || match.score < minScore) {
-                                continue;
+                    // Fuzzy search across multiple fields
+                    if (!query.isEmpty()) {
+                        FuzzyMatch match = FuzzySearch::match(query, app.searchText);
+                        if (!match.isMatch || match.score < minScore) {
+                            if (typoTolerance > 0) {
+                                rejected.append(i);
                             }
+                            continue;
                         }
+                    }
 
-                        newPaths.insert(path);
+                    newPaths.insert(app.path);
 
-                        // Check maxResults
-                        if (maxResults > 0 && newPaths.size() >= maxResults) {
-                            break;
-                        }
-                    }
+                    // Check maxResults
                     if (maxResults > 0 && newPaths.size() >= maxResults) {
                         break;
                     }
                 }
 
+                if (!rejected.isEmpty() && newPaths.size() < typoThreshold) {
+                    QList<QPair<int, qsizetype>> typoMatches; // (edit distance, app)
+                    for (const qsizetype i : std::as_const(rejected)) {
+                        const int distance = FuzzySearch::approximateDistance(query, catalog->apps.at(i).searchText, typoTolerance);
+                        if (distance > 0) {
+                            typoMatches.append(qMakePair(distance, i));
+                        }
+                    }
+                    addTypoMatches(newPaths, typoMatches, maxResults, [&catalog](qsizetype i) {
+                        return catalog->apps.at(i).path;
+                    });
+                }
+
                 if (promise.isCanceled() || newPaths == oldPaths) {
                     return;
                 }
 
-                promise.addResult(qMakePair(oldPaths - newPaths, newPaths - oldPaths));
+                promise.addResult(FileSystemChanges { oldPaths - newPaths, newPaths - oldPaths, {}, {} });
                 return;
             }
 
-            const auto flags = recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags;
+            // Everything else is answered from the in-memory index. The tree is
+            // only walked the first time, or after path/recursion options change.
+            const auto isCanceled = [&promise]() {
+                return promise.isCanceled();
+            };
+            if (!index->ensureBuilt(isCanceled)) {
+                return;
+            }
+            index->applyQueuedChanges();
+
+            // Images filter: accept all supported image formats.
+            // Category filters (Videos, Music, Documents) go by the type the index gave each path.
+            // Note: nameFilters is intentionally IGNORED for specialized filters (Images, categories,
+            // Applications) to provide complete filter specifications. Users should use filter: Files
+            // with nameFilters if they want to restrict to specific formats.
+            FileType::Category category = FileType::Category::Unknown;
+            if (filter == Videos) {
+                category = FileType::Category::Video;
+            } else if (filter == Music) {
+                category = FileType::Category::Audio;
+            } else if (filter == Documents) {
+                category = FileType::Category::Document;
+            }
+            const bool specialized = filter == Images || category != FileType::Category::Unknown;
+
+            QList<QRegularExpression> namePatterns;
+            if (!specialized) {
+                for (const auto& nameFilter : nameFilters) {
+                    namePatterns << QRegularExpression(QRegularExpression::wildcardToRegularExpression(nameFilter),
+                                                       QRegularExpression::CaseInsensitiveOption);
+                }
+            }
 
-            std::optional<QDirIterator> iter;
+            QSet<QString> newPaths;
 
-            // Images filter: Generate patterns for all supported image formats.
-            // Note: nameFilters is intentionally IGNORED for specialized filters (Images, Applications)
-            // to provide complete filter specifications. Users should use filter: Files with nameFilters
-            // if they want to restrict to specific image formats.
-            if (filter == Images) {
-                QStringList imageNameFilters;  // Start with empty list (don't use nameFilters)
-                const auto formats = QImageReader::supportedImageFormats();
-                for (const auto& format : formats) {
-                    imageNameFilters << "*." + format;
+            // Entries still to be looked at once the lock is released. The index
+            // may be compacted after that, so they are kept by path, not by id.
+            struct Candidate {
+                QString path;
+                QString name;
+                FileType type;
+            };
+
+            // Names that passed every other check but still have to be opened
+            QList<Candidate> unopened;
+
+            // Names the exact matcher rejected, looked at again only if it comes up
+            // short. Scoped updates leave near misses to the full query.
+            QList<Candidate> nearMisses;
+            const bool keepNearMisses = !query.isEmpty() && typoTolerance > 0 && scope.isEmpty();
+
+            // Header probes, kept for the result rows. Opening the file is the
+            // expensive part of the Images filter and of content sniffing, so it
+            // is checked last, and outside the index lock so writers don't wait on the disk.
+            QHash<QString, ImageInfo> images;
+            const auto isImage = [&images](const QString& path) {
+                const ImageInfo info = ImageProbe::probe(path);
+                images.insert(path, info);
+                return info.isImage();
+            };
+
+            // Types of rows the model doesn't have yet, as the index knows them
+            QHash<QString, FileType> types;
+            const auto keepType = [&types, &oldPaths](const QString& path, FileType type) {
+                if (!oldPaths.contains(path)) {
+                    types.insert(path, type);
                 }
+            };
 
-                QDir::Filters filters = QDir::Files;
-                if (showHidden) {
-                    filters |= QDir::Hidden;
+            // The checks that may have to open the file, made once the name matched
+            const auto isWanted = [&](const QString& path, FileType& type) {
+                if (filter == Images) {
+                    return isImage(path);
+                }
+                if (category != FileType::Category::Unknown) {
+                    type = FileType::fromFile(path, type);
+                    return type.category() == category;
                 }
+                return true;
+            };
 
-                iter.emplace(dir, imageNameFilters, filters, flags);
-            } else {
-                QDir::Filters filters;
+            QReadLocker locker(index->lock());
 
-                if (filter == Files) {
-                    filters = QDir::Files;
-                } else if (filter == Dirs) {
-                    filters = QDir::Dirs | QDir::NoDotAndDotDot;
-                } else {
-                    filters = QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot;
+            const auto consider = [&](quint32 id) {
+                const auto& entry = index->entry(id);
+                if (!entry.alive) {
+                    return;
                 }
 
-                if (showHidden) {
-                    filters |= QDir::Hidden;
+                if (filter == Files || specialized) {
+                    if (entry.isDir) {
+                        return;
+                    }
+                } else if (filter == Dirs && !entry.isDir) {
+                    return;
                 }
 
-                if (nameFilters.isEmpty()) {
-                    iter.emplace(dir, filters, flags);
-                } else {
-                    iter.emplace(dir, nameFilters, filters, flags);
+                // Cheap checks by name first; files the name can't place are looked at below
+                FileType type = entry.type;
+                if (filter == Images) {
+                    if (!ImageProbe::hasImageSuffix(entry.name)) {
+                        return;
+                    }
+                } else if (category != FileType::Category::Unknown) {
+                    if (type.isResolved() && type.category() != category) {
+                        return;
+                    }
+                } else if (!namePatterns.isEmpty()) {
+                    const bool matched = std::any_of(namePatterns.cbegin(), namePatterns.cend(), [&entry](const auto& pattern) {
+                        return pattern.match(entry.name).hasMatch();
+                    });
+                    if (!matched) {
+                        return;
+                    }
                 }
-            }
 
-            QSet<QString> newPaths;
+                // Apply fuzzy search filter if query is set
+                if (!query.isEmpty()) {
+                    FuzzyMatch match = FuzzySearch::match(query, entry.name);
 
-            // For efficient depth checking
-            const QString baseDir = dir.endsWith('/') ? dir : dir + '/';
-            const int baseDirDepth = baseDir.count('/');
+                    if (!match.isMatch || match.score < minScore) {
+                        if (keepNearMisses) {
+                            nearMisses.append({ entry.path, entry.name, type });
+                        }
+                        return; // Skip files that don't match the query
+                    }
+                }
 
-            while (iter->hasNext()) {
-                if (promise.isCanceled()) {
+                // Images are always probed; category filters sniff only names the suffix table left open
+                if (filter == Images || (category != FileType::Category::Unknown && !type.isResolved())) {
+                    unopened.append({ entry.path, entry.name, type });
                     return;
                 }
 
-                // Check if we've reached max results
-                if (maxResults > 0 && newPaths.size() >= maxResults) {
-                    break;
+                if (!isWanted(entry.path, type)) {
+                    return;
                 }
 
-                QString path = iter->next();
-
-                // Check depth limit if recursive and maxDepth is set
-                if (recursive && maxDepth >= 0) {
-                    int currentDepth = path.count('/') - baseDirDepth;
-                    if (currentDepth > maxDepth) {
+                newPaths.insert(entry.path);
+                keepType(entry.path, type);
+            };
+
+            const auto resultsFull = [&]() {
+                return limit > 0 && newPaths.size() >= limit;
+            };
+
+            // A scoped update looks only at what the watcher saw change and
+            // everything inside it, in the same order a full query would
+            std::optional<QVector<quint32>> scopeIds;
+            if (!scope.isEmpty()) {
+                QSet<quint32> seen;
+                QList<quint32> pending;
+                for (const auto& path : scope) {
+                    if (const auto id = index->find(path)) {
+                        pending.append(*id);
+                    }
+                }
+                while (!pending.isEmpty()) {
+                    const quint32 id = pending.takeLast();
+                    if (seen.contains(id)) {
                         continue;
                     }
+                    seen.insert(id);
+                    const auto& entry = index->entry(id);
+                    if (entry.isDir) {
+                        pending.append(index->children(entry.path));
+                    }
                 }
+                scopeIds = QVector<quint32>(seen.cbegin(), seen.cend());
+                std::sort(scopeIds->begin(), scopeIds->end());
+            }
 
-                if (filter == Images) {
-                    QImageReader reader(path);
-                    if (!reader.canRead()) {
-                        continue;
+            // Names containing the whole query come straight from the trigram postings
+            std::optional<QVector<quint32>> candidates;
+            if (!query.isEmpty()) {
+                candidates = index->candidates(query);
+            }
+            if (candidates.has_value() && scopeIds.has_value()) {
+                QVector<quint32> inScope;
+                std::set_intersection(candidates->cbegin(), candidates->cend(), scopeIds->cbegin(), scopeIds->cend(),
+                                      std::back_inserter(inScope));
+                candidates = std::move(inScope);
+            }
+
+            if (candidates.has_value()) {
+                for (const quint32 id : std::as_const(*candidates)) {
+                    if (promise.isCanceled()) {
+                        return;
+                    }
+                    if (resultsFull()) {
+                        break;
                     }
+                    consider(id);
                 }
+            }
 
-                // Apply fuzzy search filter if query is set
-                if (!query.isEmpty()) {
-                    QFileInfo fileInfo(path);
-                    QString fileName = fileInfo.fileName();
-                    FuzzyMatch match = FuzzySearch::match(query, fileName);
+            // Short queries need a linear scan. Longer ones go on to the names outside
+            // the trigram candidates, for subsequence and typo matches, only while the
+            // substring matches are fewer than typoThreshold, so common queries stay
+            // sublinear. Scoped updates count the rows outside the scope as well.
+            bool scan = !resultsFull();
+            if (scan && candidates.has_value()) {
+                scan = outsideRows + newPaths.size() + unopened.size() < typoThreshold;
+            }
+            if (scan) {
+                const quint32 count = scopeIds.has_value() ? static_cast<quint32>(scopeIds->size()) : index->size();
+                qsizetype nextCandidate = 0;
+                for (quint32 i = 0; i < count; ++i) {
+                    if (promise.isCanceled()) {
+                        return;
+                    }
+                    if (resultsFull()) {
+                        break;
+                    }
 
-                    if (!match.isMatch || match.score < minScore) {
-                        continue; // Skip files that don't match the query
+                    // Both lists are ascending, so skipping already scored ids is a merge
+                    const quint32 id = scopeIds.has_value() ? scopeIds->at(i) : i;
+                    if (candidates.has_value() && nextCandidate < candidates->size() && candidates->at(nextCandidate) == id) {
+                        ++nextCandidate;
+                        continue;
                     }
+                    consider(id);
+                }
+            }
+
+            locker.unlock();
+
+            // Then the files only their contents can place, in index order until the results are full
+            for (auto& candidate : unopened) {
+                if (promise.isCanceled()) {
+                    return;
+                }
+                if (resultsFull()) {
+                    break;
                 }
+                if (isWanted(candidate.path, candidate.type)) {
+                    newPaths.insert(candidate.path);
+                    keepType(candidate.path, candidate.type);
+                }
+            }
 
-                newPaths.insert(path);
+            // Capped results and near misses are weighed against every other
+            // match, which only a full query sees
+            if (!scope.isEmpty()) {
+                const qsizetype rows = outsideRows + newPaths.size();
+                const bool typosWanted = !query.isEmpty() && typoTolerance > 0 && rows < typoThreshold;
+                if ((maxResults > 0 && rows >= maxResults) || typosWanted) {
+                    FileSystemChanges changes;
+                    changes.needsFullQuery = true;
+                    promise.addResult(changes);
+                    return;
+                }
+            } else if (!nearMisses.isEmpty() && newPaths.size() < typoThreshold) {
+                QList<QPair<int, qsizetype>> typoMatches; // (edit distance, near miss)
+                for (qsizetype i = 0; i < nearMisses.size(); ++i) {
+                    if (promise.isCanceled()) {
+                        return;
+                    }
+                    const int distance = FuzzySearch::approximateDistance(query, nearMisses.at(i).name, typoTolerance);
+                    if (distance > 0) {
+                        typoMatches.append(qMakePair(distance, i));
+                    }
+                }
+                addTypoMatches(newPaths, typoMatches, maxResults, [&](qsizetype i) {
+                    auto& nearMiss = nearMisses[i];
+                    if (!isWanted(nearMiss.path, nearMiss.type)) {
+                        return QString();
+                    }
+                    keepType(nearMiss.path, nearMiss.type);
+                    return nearMiss.path;
+                });
             }
 
             if (promise.isCanceled() || newPaths == oldPaths) {
                 return;
             }
 
-            promise.addResult(qMakePair(oldPaths - newPaths, newPaths - oldPaths));
+            // New rows come with their type, sniffing only those the name left open,
+            // and those named like images with their header probe, in one batch here
+            FileSystemChanges changes { oldPaths - newPaths, newPaths - oldPaths, {}, {}, !scope.isEmpty() };
+            for (const auto& path : std::as_const(changes.added)) {
+                if (promise.isCanceled()) {
+                    return;
+                }
+
+                changes.types.insert(path, FileType::fromFile(path, types.value(path)));
+
+                const auto probed = images.constFind(path);
+                if (probed != images.cend()) {
+                    changes.images.insert(path, *probed);
+                } else if (ImageProbe::hasImageSuffix(path)) {
+                    changes.images.insert(path, ImageProbe::probe(path));
+                }
+            }
+
+            promise.addResult(changes);
         });
 
         if (m_futures.contains(dir)) {
@@ -1046,11 +1194,16 @@ namespace quicksearch::models {
         }
         m_futures.insert(dir, future);
 
-        const auto watcher = new QFutureWatcher<QPair<QSet<QString>, QSet<QString>>>(this);
+        const auto watcher = new QFutureWatcher<FileSystemChanges>(this);
 
-        connect(watcher, &QFutureWatcher<QPair<QSet<QString>, QSet<QString>>>::finished, this, [dir, watcher, taskGeneration, this]() {
+        connect(watcher, &QFutureWatcher<FileSystemChanges>::finished, this, [dir, watcher, taskGeneration, scopeTask, this]() {
             m_futures.remove(dir);
 
+            // The latest update has looked at every change so far
+            if (scopeTask == m_scopeTask) {
+                m_scope.clear();
+            }
+
             if (!watcher->future().isResultReadyAt(0)) {
                 watcher->deleteLater();
                 return;
@@ -1064,20 +1217,39 @@ namespace quicksearch::models {
                 return;
             }
 
-            const auto result = watcher->result();
-            applyChanges(result.first, result.second);
-
+            const FileSystemChanges changes = watcher->result();
             watcher->deleteLater();
+
+            // The scope alone couldn't decide; this also covers any newer changes
+            if (changes.needsFullQuery) {
+                updateEntriesForDir(dir);
+                return;
+            }
+
+            applyChanges(changes);
         });
 
         watcher->setFuture(future);
     }
 
-    void FileSystemModel::applyChanges(const QSet<QString>& removedPaths, const QSet<QString>& addedPaths) {
+    void FileSystemModel::applyChanges(const FileSystemChanges& changes) {
+        // Removed rows are found through their directory, not by comparing every row
         QList<int> removedIndices;
-        for (int i = 0; i < m_entries.size(); ++i) {
-            if (removedPaths.contains(m_entries[i]->path())) {
-                removedIndices << i;
+        for (const auto& path : changes.removed) {
+            const auto rows = m_rowsByDir.find(parentOf(path));
+            if (rows == m_rowsByDir.end()) {
+                continue;
+            }
+
+            const FileSystemEntry* entry = rows->take(path);
+            if (rows->isEmpty()) {
+                m_rowsByDir.erase(rows);
+            }
+            if (entry) {
+                const int row = rowOf(entry);
+                if (row >= 0) {
+                    removedIndices << row;
+                }
             }
         }
         std::sort(removedIndices.begin(), removedIndices.end(), std::greater<int>());
@@ -1113,17 +1285,41 @@ namespace quicksearch::models {
         // Create new entries
         QList<FileSystemEntry*> newEntries;
 
-        // Build a set of existing paths to prevent duplicates
-        QSet<QString> existingPaths;
-        for (const auto& entry : std::as_const(m_entries)) {
-            existingPaths.insert(entry->path());
+        // Only create entries for paths that don't already exist
+        for (const auto& path : changes.added) {
+            QHash<QString, FileSystemEntry*>& siblings = m_rowsByDir[parentOf(path)];
+            if (!siblings.contains(path)) {
+                auto* entry = new FileSystemEntry(path, m_dir.relativeFilePath(path), this);
+                siblings.insert(path, entry);
+                const auto image = changes.images.constFind(path);
+                if (image != changes.images.cend()) {
+                    entry->setImageInfo(*image);
+                }
+                const auto type = changes.types.constFind(path);
+                if (type != changes.types.cend()) {
+                    entry->setFileType(*type);
+                }
+                newEntries << entry;
+            }
         }
 
-        // Only create entries for paths that don't already exist
-        for (const auto& path : addedPaths) {
-            if (!existingPaths.contains(path)) {
-                newEntries << new FileSystemEntry(path, m_dir.relativeFilePath(path), this);
+        // A few rows from the watcher go straight to their place; the rest of the
+        // list is still sorted, and its delegates stay as they are
+        if (changes.scoped && m_sort) {
+            for (auto* entry : std::as_const(newEntries)) {
+                const auto it = std::upper_bound(m_entries.begin(), m_entries.end(), entry,
+                                                 [this](const FileSystemEntry* a, const FileSystemEntry* b) {
+                                                     return compareEntries(a, b);
+                                                 });
+                const int row = static_cast<int>(it - m_entries.begin());
+                beginInsertRows(QModelIndex(), row, row);
+                m_entries.insert(row, entry);
+                endInsertRows();
             }
+
+            emit entriesChanged();
+            emit lengthChanged();
+            return;
         }
 
         // Append new entries to the list
@@ -1143,8 +1339,39 @@ namespace quicksearch::models {
         emit lengthChanged();
     }
 
+    int FileSystemModel::rowOf(const FileSystemEntry* entry) const {
+        // A sorted list is bisected down to the rows that compare equal
+        auto first = m_entries.cbegin();
+        auto last = m_entries.cend();
+        if (m_sort) {
+            const auto range = std::equal_range(first, last, entry, [this](const FileSystemEntry* a, const FileSystemEntry* b) {
+                return compareEntries(a, b);
+            });
+            first = range.first;
+            last = range.second;
+        }
+        const auto it = std::find(first, last, entry);
+        if (it != last) {
+            return static_cast<int>(it - m_entries.cbegin());
+        }
+
+        // Not where the order says, e.g. after a sort property's value changed
+        return static_cast<int>(m_entries.indexOf(entry));
+    }
+
     void FileSystemModel::resortEntries() {
         if (!m_entries.isEmpty() && m_sort) {
+            // Usage decays with time, so it is read once per row up front and the
+            // comparisons all see the same values
+            if (!m_query.isEmpty()) {
+                const auto* frecency = FrecencyStore::instance();
+                m_boostCache.clear();
+                for (const auto* entry : std::as_const(m_entries)) {
+                    const QString key = entry->usageKey();
+                    m_boostCache.insert(key, frecency->boost(key));
+                }
+            }
+
             beginResetModel();
             std::sort(m_entries.begin(), m_entries.end(), [this](const FileSystemEntry* a, const FileSystemEntry* b) {
                 return compareEntries(a, b);
@@ -1210,6 +1437,18 @@ namespace quicksearch::models {
                 }
             }
 
+            // Typo matches scored below minScore; they stay after the exact
+            // matches however often they are used
+            const bool exactA = scoreA > 0.0 && scoreA >= m_minScore;
+            const bool exactB = scoreB > 0.0 && scoreB >= m_minScore;
+            if (exactA != exactB) {
+                return m_sortReverse ? exactB : exactA;
+            }
+
+            // Things the user opens often and recently rank higher within a tier
+            scoreA += boostOf(a);
+            scoreB += boostOf(b);
+
             if (!qFuzzyCompare(scoreA, scoreB)) {
                 return m_sortReverse ? scoreA < scoreB : scoreA > scoreB;
             }
@@ -1232,6 +1471,18 @@ namespace quicksearch::models {
         return m_sortReverse ? cmp > 0 : cmp < 0;
     }
 
+    double FileSystemModel::boostOf(const FileSystemEntry* entry) const {
+        // Rows inserted since the last sort are read when first compared
+        const QString key = entry->usageKey();
+        const auto it = m_boostCache.constFind(key);
+        if (it != m_boostCache.cend()) {
+            return *it;
+        }
+        const double boost = FrecencyStore::instance()->boost(key);
+        m_boostCache.insert(key, boost);
+        return boost;
+    }
+
     bool FileSystemModel::matchesQuery(const QString& path) const {
         if (m_query.isEmpty()) {
             return true;
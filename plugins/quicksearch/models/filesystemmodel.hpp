@@ -5,17 +5,20 @@
 
 #include <qabstractitemmodel.h>
 #include <qdir.h>
-#include <qfilesystemwatcher.h>
 #include <qfuture.h>
 #include <qimage.h>
-#include <qimagereader.h>
-#include <qmimedatabase.h>
+#include <qmap.h>
 #include <qobject.h>
 #include <qqmlintegration.h>
 #include <qqmllist.h>
+#include <memory>
 #include <optional>
 
 #include "desktopentry.hpp"
+#include "filetype.hpp"
+#include "imageprobe.hpp"
+#include "pathindex.hpp"
+#include "thumbnailprefetcher.hpp"
 
 namespace quicksearch::models {
 
@@ -33,6 +36,9 @@ namespace quicksearch::models {
         Q_PROPERTY(qint64 size READ size CONSTANT)
         Q_PROPERTY(bool isDir READ isDir CONSTANT)
         Q_PROPERTY(bool isImage READ isImage CONSTANT)
+        // As displayed, i.e. with the EXIF orientation applied; invalid if unknown
+        Q_PROPERTY(QSize imageSize READ imageSize CONSTANT)
+        Q_PROPERTY(int imageOrientation READ imageOrientation CONSTANT)
         Q_PROPERTY(QString imageThumbnail READ imageThumbnail CONSTANT)
         Q_PROPERTY(bool isVideo READ isVideo CONSTANT)
         Q_PROPERTY(QString videoThumbnail READ videoThumbnail CONSTANT)
@@ -46,6 +52,7 @@ namespace quicksearch::models {
         Q_PROPERTY(QString genericName READ genericName CONSTANT)
         Q_PROPERTY(QString comment READ comment CONSTANT)
         Q_PROPERTY(QString icon READ icon CONSTANT)
+        Q_PROPERTY(QString iconPath READ iconPath NOTIFY iconPathChanged)
         Q_PROPERTY(QStringList command READ command CONSTANT)
         Q_PROPERTY(QString execString READ execString CONSTANT)
         Q_PROPERTY(QStringList categories READ categories CONSTANT)
@@ -69,6 +76,8 @@ namespace quicksearch::models {
         [[nodiscard]] qint64 size() const;
         [[nodiscard]] bool isDir() const;
         [[nodiscard]] bool isImage() const;
+        [[nodiscard]] QSize imageSize() const;
+        [[nodiscard]] int imageOrientation() const;
         [[nodiscard]] QString imageThumbnail() const;
         [[nodiscard]] bool isVideo() const;
         [[nodiscard]] QString videoThumbnail() const;
@@ -82,6 +91,7 @@ namespace quicksearch::models {
         [[nodiscard]] QString genericName() const;
         [[nodiscard]] QString comment() const;
         [[nodiscard]] QString icon() const;
+        [[nodiscard]] QString iconPath() const;
         [[nodiscard]] QStringList command() const;
         [[nodiscard]] QString execString() const;
         [[nodiscard]] QStringList categories() const;
@@ -94,11 +104,23 @@ namespace quicksearch::models {
         [[nodiscard]] QString startupClass() const;
 
         Q_INVOKABLE void execute();
+        // Launches with files or URLs for the Exec field codes
+        Q_INVOKABLE void execute(const QList<QUrl>& urls);
+        // Opens the file with its default application (xdg-open)
+        Q_INVOKABLE void open();
+
+        // Key under which uses of this entry are counted: desktop ID or path
+        [[nodiscard]] QString usageKey() const;
 
         void updateRelativePath(const QDir& dir);
 
+        // Made on the model's worker, so the GUI thread never has to look at the file
+        void setImageInfo(const ImageInfo& info);
+        void setFileType(FileType type);
+
     signals:
         void relativePathChanged();
+        void iconPathChanged();
 
     private:
         const QFileInfo m_fileInfo;
@@ -106,32 +128,30 @@ namespace quicksearch::models {
         const QString m_path;
         QString m_relativePath;
 
-        mutable bool m_isImage;
-        mutable bool m_isImageInitialised;
-
-        mutable QString m_imageThumbnail;
-        mutable bool m_imageThumbnailInitialised;
-
-        mutable bool m_isVideo;
-        mutable bool m_isVideoInitialised;
-
-        mutable QString m_videoThumbnail;
-        mutable bool m_videoThumbnailInitialised;
-
-        mutable bool m_isMusic;
-        mutable bool m_isMusicInitialised;
-
-        mutable QString m_musicThumbnail;
-        mutable bool m_musicThumbnailInitialised;
+        mutable std::optional<ImageInfo> m_imageInfo;
 
-        mutable QString m_mimeType;
-        mutable bool m_mimeTypeInitialised;
+        mutable FileType m_fileType; // isVideo, isMusic and mimeType all read this
 
-        mutable std::optional<DesktopEntryData> m_desktopData;
+        mutable std::shared_ptr<const DesktopEntryData> m_desktopData;
         mutable bool m_desktopDataInitialised;
 
+        // Created on first read of the actions property, owned by this entry
+        mutable QList<DesktopAction*> m_actions;
+        mutable bool m_actionsInitialised;
+
         void ensureDesktopDataLoaded() const;
-        [[nodiscard]] bool isMostlyBlack(const QImage& image) const;
+        const ImageInfo& imageInfo() const;
+        FileType fileType() const;
+    };
+
+    // What a query found, worked out on the worker
+    struct FileSystemChanges {
+        QSet<QString> removed;
+        QSet<QString> added;
+        QHash<QString, ImageInfo> images; // header probes of added files named like images
+        QHash<QString, FileType> types;   // of every added path
+        bool scoped = false;              // only some paths were looked at; rows elsewhere stand
+        bool needsFullQuery = false;      // a scoped update found it depends on rows outside its scope
     };
 
     class FileSystemModel : public QAbstractListModel {
@@ -141,6 +161,8 @@ namespace quicksearch::models {
         Q_PROPERTY(QString path READ path WRITE setPath NOTIFY pathChanged)
         Q_PROPERTY(bool recursive READ recursive WRITE setRecursive NOTIFY recursiveChanged)
         Q_PROPERTY(bool watchChanges READ watchChanges WRITE setWatchChanges NOTIFY watchChangesChanged)
+        // True when fs.inotify.max_user_watches ran out before the whole tree was watched
+        Q_PROPERTY(bool watchLimitReached READ watchLimitReached NOTIFY watchLimitReachedChanged)
         Q_PROPERTY(bool showHidden READ showHidden WRITE setShowHidden NOTIFY showHiddenChanged)
         Q_PROPERTY(bool sort READ sort WRITE setSort NOTIFY sortChanged)
         Q_PROPERTY(QString sortProperty READ sortProperty WRITE setSortProperty NOTIFY sortPropertyChanged)
@@ -151,6 +173,8 @@ namespace quicksearch::models {
         Q_PROPERTY(double minScore READ minScore WRITE setMinScore NOTIFY minScoreChanged)
         Q_PROPERTY(int maxDepth READ maxDepth WRITE setMaxDepth NOTIFY maxDepthChanged)
         Q_PROPERTY(int maxResults READ maxResults WRITE setMaxResults NOTIFY maxResultsChanged)
+        Q_PROPERTY(int typoTolerance READ typoTolerance WRITE setTypoTolerance NOTIFY typoToleranceChanged)
+        Q_PROPERTY(int typoThreshold READ typoThreshold WRITE setTypoThreshold NOTIFY typoThresholdChanged)
 
         Q_PROPERTY(QQmlListProperty<quicksearch::models::FileSystemEntry> entries READ entries NOTIFY entriesChanged)
         Q_PROPERTY(int length READ length NOTIFY lengthChanged)
@@ -161,7 +185,10 @@ namespace quicksearch::models {
             Images,
             Files,
             Dirs,
-            Applications
+            Applications,
+            Videos,
+            Music,
+            Documents
         };
         Q_ENUM(Filter)
 
@@ -180,6 +207,8 @@ namespace quicksearch::models {
         [[nodiscard]] bool watchChanges() const;
         void setWatchChanges(bool watchChanges);
 
+        [[nodiscard]] bool watchLimitReached() const;
+
         [[nodiscard]] bool showHidden() const;
         void setShowHidden(bool showHidden);
 
@@ -210,15 +239,27 @@ namespace quicksearch::models {
         [[nodiscard]] int maxResults() const;
         void setMaxResults(int maxResults);
 
+        [[nodiscard]] int typoTolerance() const;
+        void setTypoTolerance(int typoTolerance);
+
+        [[nodiscard]] int typoThreshold() const;
+        void setTypoThreshold(int typoThreshold);
+
         [[nodiscard]] QQmlListProperty<FileSystemEntry> entries();
         [[nodiscard]] int length() const;
 
         Q_INVOKABLE QList<QObject*> slice(int start, int count);
 
+        // Makes thumbnails of at most size pixels for count entries from start
+        // at low priority, typically the screenful below the visible one.
+        // Work for entries outside the last range given is canceled.
+        Q_INVOKABLE void prefetch(int start, int count, int size = 0);
+
     signals:
         void pathChanged();
         void recursiveChanged();
         void watchChangesChanged();
+        void watchLimitReachedChanged();
         void showHiddenChanged();
         void sortChanged();
         void sortPropertyChanged();
@@ -229,19 +270,26 @@ namespace quicksearch::models {
         void minScoreChanged();
         void maxDepthChanged();
         void maxResultsChanged();
+        void typoToleranceChanged();
+        void typoThresholdChanged();
         void entriesChanged();
         void lengthChanged();
 
     private:
         QDir m_dir;
-        QFileSystemWatcher m_watcher;
         QList<FileSystemEntry*> m_entries;
-        QHash<QString, QFuture<QPair<QSet<QString>, QSet<QString>>>> m_futures;
+        QMap<QString, QHash<QString, FileSystemEntry*>> m_rowsByDir; // parent directory -> its rows by path; ordered for subtrees
+        std::shared_ptr<PathIndex> m_index;
+        ThumbnailPrefetcher m_prefetcher;
+        QHash<QString, QFuture<FileSystemChanges>> m_futures;
         uint64_t m_taskGeneration;
+        QSet<QString> m_scope; // changed paths the running scoped update looks at
+        uint64_t m_scopeTask;
 
         QString m_path;
         bool m_recursive;
         bool m_watchChanges;
+        bool m_watchLimitReached;
         bool m_showHidden;
         bool m_sort;
         QString m_sortProperty;
@@ -252,17 +300,27 @@ namespace quicksearch::models {
         double m_minScore;
         int m_maxDepth;
         int m_maxResults;
+        int m_typoTolerance;
+        int m_typoThreshold;
 
         mutable QHash<QString, double> m_scoreCache;
+        mutable QHash<QString, double> m_boostCache; // usage key -> frecency boost, read once per query or sort
 
-        void watchDirIfRecursive(const QString& path);
+        void onIndexesChanged(const QHash<const PathIndex*, QSet<QString>>& paths);
+        void onCatalogChanged();
         void update();
-        void updateWatcher();
+        void updateWatchLimitReached();
         void updateEntries();
-        void updateEntriesForDir(const QString& dir);
-        void applyChanges(const QSet<QString>& removedPaths, const QSet<QString>& addedPaths);
+        // With a scope, only those paths and what's inside them are queried
+        void updateEntriesForDir(const QString& dir, const QSet<QString>& scope = {});
+        [[nodiscard]] bool canUpdateInScope() const;
+        [[nodiscard]] QSet<QString> rowsInScope(const QSet<QString>& scope) const;
+        void clearEntries();
+        void applyChanges(const FileSystemChanges& changes);
+        [[nodiscard]] int rowOf(const FileSystemEntry* entry) const;
         void resortEntries();
         [[nodiscard]] bool compareEntries(const FileSystemEntry* a, const FileSystemEntry* b) const;
+        [[nodiscard]] double boostOf(const FileSystemEntry* entry) const;
         [[nodiscard]] bool matchesQuery(const QString& path) const;
     };
 
@@ -0,0 +1,186 @@
+#include "filetype.hpp"
+
+#include <QHash>
+#include <QMimeDatabase>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
+#include <QWriteLocker>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        struct Table {
+            QReadWriteLock lock;
+            QStringList names;                  // code - 1 -> name
+            QHash<QString, quint16> codes;      // name -> code
+            QHash<QString, quint16> suffixes;   // suffix -> code, 0 if the suffix alone can't decide
+        };
+
+        Table& table() {
+            static Table instance;
+            return instance;
+        }
+
+        // Globs the suffix table would get wrong: whole file names ("Makefile")
+        // and the outer suffixes of compound ones ("gz" of "*.tar.gz"). Names
+        // they match are looked up in the database as a whole.
+        struct SpecialGlobs {
+            QSet<QString> names; // lowercased
+            QSet<QString> outerSuffixes;
+        };
+
+        const SpecialGlobs& specialGlobs() {
+            static const SpecialGlobs globs = []() {
+                SpecialGlobs result;
+                const auto types = QMimeDatabase().allMimeTypes();
+                for (const auto& type : types) {
+                    const auto patterns = type.globPatterns();
+                    for (const auto& pattern : patterns) {
+                        if (pattern.startsWith("*.")) {
+                            const QString suffix = pattern.mid(2);
+                            const qsizetype dot = suffix.lastIndexOf('.');
+                            if (dot >= 0) {
+                                result.outerSuffixes.insert(suffix.mid(dot + 1).toLower());
+                            }
+                        } else if (!pattern.contains('*') && !pattern.contains('?') && !pattern.contains('[')) {
+                            result.names.insert(pattern.toLower());
+                        }
+                    }
+                }
+                return result;
+            }();
+            return globs;
+        }
+
+        // Things people read: office formats, PDFs, e-books and plain text
+        const QSet<QString> DocumentTypes = {
+            "application/pdf",
+            "application/postscript",
+            "application/rtf",
+            "application/msword",
+            "application/vnd.ms-excel",
+            "application/vnd.ms-powerpoint",
+            "application/epub+zip",
+            "application/x-mobipocket-ebook",
+            "application/x-fictionbook+xml",
+            "application/vnd.comicbook+zip",
+            "application/vnd.comicbook-rar",
+            "image/vnd.djvu",
+            "text/plain",
+            "text/markdown",
+            "text/csv",
+        };
+
+        FileType::Category categoryOf(const QString& mimeType) {
+            if (mimeType == "inode/directory") {
+                return FileType::Category::Directory;
+            }
+            if (DocumentTypes.contains(mimeType) || mimeType.startsWith("application/vnd.oasis.opendocument.") ||
+                mimeType.startsWith("application/vnd.openxmlformats-officedocument.")) {
+                return FileType::Category::Document;
+            }
+            if (mimeType.startsWith("image/")) {
+                return FileType::Category::Image;
+            }
+            if (mimeType.startsWith("video/")) {
+                return FileType::Category::Video;
+            }
+            if (mimeType.startsWith("audio/")) {
+                return FileType::Category::Audio;
+            }
+            return FileType::Category::Other;
+        }
+
+        // The single type the database's globs give a file name, or nothing
+        QString typeForName(const QString& name) {
+            const auto types = QMimeDatabase().mimeTypesForFileName(name);
+            return types.size() == 1 ? types.first().name() : QString();
+        }
+
+    } // namespace
+
+    FileType FileType::intern(const QString& mimeType) {
+        Table& t = table();
+        FileType type;
+        type.m_category = categoryOf(mimeType);
+
+        {
+            QReadLocker locker(&t.lock);
+            type.m_code = t.codes.value(mimeType);
+        }
+        if (type.m_code != 0) {
+            return type;
+        }
+
+        QWriteLocker locker(&t.lock);
+        type.m_code = t.codes.value(mimeType);
+        if (type.m_code == 0) {
+            t.names.append(mimeType);
+            type.m_code = static_cast<quint16>(t.names.size());
+            t.codes.insert(mimeType, type.m_code);
+        }
+        return type;
+    }
+
+    FileType FileType::fromName(const QString& name, bool isDir) {
+        if (isDir) {
+            return intern(QStringLiteral("inode/directory"));
+        }
+
+        const qsizetype dot = name.lastIndexOf('.');
+        const QString suffix = dot > 0 ? name.mid(dot + 1) : QString();
+        const SpecialGlobs& globs = specialGlobs();
+        if (suffix.isEmpty() || globs.names.contains(name.toLower()) || globs.outerSuffixes.contains(suffix.toLower())) {
+            const QString mimeType = typeForName(name);
+            return mimeType.isEmpty() ? FileType() : intern(mimeType);
+        }
+
+        Table& t = table();
+        {
+            QReadLocker locker(&t.lock);
+            const auto it = t.suffixes.constFind(suffix);
+            if (it != t.suffixes.cend()) {
+                if (*it == 0) {
+                    return FileType();
+                }
+                FileType type;
+                type.m_code = *it;
+                type.m_category = categoryOf(t.names.at(*it - 1));
+                return type;
+            }
+        }
+
+        // First file with this suffix: ask the globs once for all of them
+        const QString mimeType = typeForName(QStringLiteral("x.") + suffix);
+        const FileType type = mimeType.isEmpty() ? FileType() : intern(mimeType);
+
+        QWriteLocker locker(&t.lock);
+        t.suffixes.insert(suffix, type.m_code);
+        return type;
+    }
+
+    FileType FileType::fromFile(const QString& path, FileType byName) {
+        if (byName.isResolved()) {
+            return byName;
+        }
+        return intern(QMimeDatabase().mimeTypeForFile(path).name());
+    }
+
+    FileType FileType::classify(const QString& path, bool isDir) {
+        const qsizetype slash = path.lastIndexOf('/');
+        return fromFile(path, fromName(path.mid(slash + 1), isDir));
+    }
+
+    QString FileType::mimeType() const {
+        if (m_code == 0) {
+            return QString();
+        }
+        Table& t = table();
+        QReadLocker locker(&t.lock);
+        return t.names.at(m_code - 1);
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+namespace quicksearch::models {
+
+    // A file's MIME type in four bytes: a code into a process-wide table of
+    // MIME type names, and the broad category the name puts it in.
+    //
+    // Names are classified by suffix from a table learned from the MIME
+    // database's globs, one lookup per distinct suffix; only files the name
+    // can't decide (no known suffix, or a suffix several types claim) have
+    // their contents sniffed. A default-constructed FileType is unresolved.
+    //
+    // Thread-safe.
+    class FileType {
+    public:
+        enum class Category : quint8 {
+            Unknown,
+            Directory,
+            Image,
+            Video,
+            Audio,
+            Document,
+            Other,
+        };
+
+        FileType() = default;
+
+        // From the name alone, without I/O. Unresolved if the name can't decide.
+        static FileType fromName(const QString& name, bool isDir);
+
+        // Sniffs the contents where the name can't decide. Blocks.
+        static FileType fromFile(const QString& path, FileType byName);
+
+        static FileType classify(const QString& path, bool isDir);
+
+        [[nodiscard]] bool isResolved() const { return m_code != 0; }
+        [[nodiscard]] Category category() const { return m_category; }
+        [[nodiscard]] QString mimeType() const;
+
+        bool operator==(const FileType& other) const { return m_code == other.m_code; }
+        bool operator!=(const FileType& other) const { return m_code != other.m_code; }
+
+    private:
+        quint16 m_code = 0; // 1-based index into the name table
+        Category m_category = Category::Unknown;
+
+        static FileType intern(const QString& mimeType);
+    };
+
+} // namespace quicksearch::models
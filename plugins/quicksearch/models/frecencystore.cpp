@@ -0,0 +1,221 @@
+#include "frecencystore.hpp"
+
+#include <QDateTime>
+#include <QDir>
+#include <QReadLocker>
+#include <QVector>
+#include <QWriteLocker>
+#include <cmath>
+#include <cstring>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        constexpr quint32 StoreMagic = 0x52464e55; // "UNFR"
+        constexpr quint32 StoreVersion = 1;
+        constexpr quint32 InitialCapacity = 1024;
+
+        constexpr double HalfLifeMinutes = 7 * 24 * 60;
+
+        // Entries decayed below this are dropped when the table grows
+        constexpr double ForgetBelow = 0.05;
+
+        // Uses at which boost() reaches half of MaxBoost
+        constexpr double HalfBoostScore = 3.0;
+
+    } // namespace
+
+    FrecencyStore* FrecencyStore::instance() {
+        static FrecencyStore store;
+        return &store;
+    }
+
+    FrecencyStore::FrecencyStore()
+    : m_header(nullptr)
+    , m_slots(nullptr) {
+        QString dataHome = qEnvironmentVariable("XDG_DATA_HOME");
+        if (dataHome.isEmpty()) {
+            dataHome = QDir::homePath() + "/.local/share";
+        }
+
+        const QString dir = dataHome + "/unite";
+        QDir().mkpath(dir);
+
+        m_file.setFileName(dir + "/frecency.bin");
+        if (!m_file.open(QIODevice::ReadWrite)) {
+            return;
+        }
+
+        // Reuse the table if it looks intact, start over otherwise
+        if (m_file.size() >= qint64(sizeof(Header))) {
+            Header header;
+            m_file.seek(0);
+            if (m_file.read(reinterpret_cast<char*>(&header), sizeof(Header)) == qint64(sizeof(Header)) &&
+                header.magic == StoreMagic && header.version == StoreVersion && header.capacity > 0 &&
+                (header.capacity & (header.capacity - 1)) == 0 && header.count < header.capacity &&
+                m_file.size() == qint64(sizeof(Header)) + qint64(header.capacity) * qint64(sizeof(Slot))) {
+                map(header.capacity, false);
+                return;
+            }
+        }
+
+        map(InitialCapacity, true);
+    }
+
+    bool FrecencyStore::map(quint32 capacity, bool reset) {
+        if (m_header) {
+            m_file.unmap(reinterpret_cast<uchar*>(m_header));
+            m_header = nullptr;
+            m_slots = nullptr;
+        }
+
+        const qint64 size = qint64(sizeof(Header)) + qint64(capacity) * qint64(sizeof(Slot));
+        if (m_file.size() != size && !m_file.resize(size)) {
+            return false;
+        }
+
+        uchar* memory = m_file.map(0, size);
+        if (!memory) {
+            return false;
+        }
+
+        m_header = reinterpret_cast<Header*>(memory);
+        m_slots = reinterpret_cast<Slot*>(memory + sizeof(Header));
+
+        if (reset) {
+            std::memset(memory, 0, size);
+            m_header->magic = StoreMagic;
+            m_header->version = StoreVersion;
+            m_header->capacity = capacity;
+            m_header->count = 0;
+        }
+
+        return true;
+    }
+
+    void FrecencyStore::record(const QString& key) {
+        if (key.isEmpty()) {
+            return;
+        }
+
+        const quint64 hash = hashKey(key);
+        const quint32 now = nowMinutes();
+
+        QWriteLocker locker(&m_lock);
+        if (!m_slots) {
+            return;
+        }
+
+        // Keep probes short: at most three quarters full
+        if (!find(hash) && (m_header->count + 1) * 4 > m_header->capacity * 3) {
+            grow();
+            if (!m_slots) {
+                return;
+            }
+        }
+
+        const quint32 mask = m_header->capacity - 1;
+        quint32 i = quint32(hash) & mask;
+        while (m_slots[i].key != 0 && m_slots[i].key != hash) {
+            i = (i + 1) & mask;
+        }
+
+        Slot& slot = m_slots[i];
+        if (slot.key == 0) {
+            slot.key = hash;
+            slot.score = 0;
+            ++m_header->count;
+        }
+
+        slot.score = float(decayed(slot, now) + 1.0);
+        slot.lastUsed = now;
+    }
+
+    double FrecencyStore::score(const QString& key) const {
+        if (key.isEmpty()) {
+            return 0.0;
+        }
+
+        const quint64 hash = hashKey(key);
+
+        QReadLocker locker(&m_lock);
+        const Slot* slot = find(hash);
+        return slot ? decayed(*slot, nowMinutes()) : 0.0;
+    }
+
+    double FrecencyStore::boost(const QString& key) const {
+        const double usage = score(key);
+        return MaxBoost * usage / (usage + HalfBoostScore);
+    }
+
+    const FrecencyStore::Slot* FrecencyStore::find(quint64 key) const {
+        if (!m_slots) {
+            return nullptr;
+        }
+
+        const quint32 mask = m_header->capacity - 1;
+        for (quint32 i = quint32(key) & mask;; i = (i + 1) & mask) {
+            if (m_slots[i].key == key) {
+                return &m_slots[i];
+            }
+            if (m_slots[i].key == 0) {
+                return nullptr;
+            }
+        }
+    }
+
+    void FrecencyStore::grow() {
+        // Called with the write lock held. Forgotten entries are dropped on the
+        // way, so a table of mostly stale keys is rebuilt at the same size.
+        const quint32 now = nowMinutes();
+
+        QVector<Slot> live;
+        live.reserve(m_header->count);
+        for (quint32 i = 0; i < m_header->capacity; ++i) {
+            const Slot& slot = m_slots[i];
+            if (slot.key != 0 && decayed(slot, now) >= ForgetBelow) {
+                live.append(slot);
+            }
+        }
+
+        quint32 capacity = m_header->capacity;
+        while ((quint32(live.size()) + 1) * 2 > capacity) {
+            capacity *= 2;
+        }
+
+        if (!map(capacity, true)) {
+            return;
+        }
+
+        const quint32 mask = capacity - 1;
+        for (const Slot& slot : std::as_const(live)) {
+            quint32 i = quint32(slot.key) & mask;
+            while (m_slots[i].key != 0) {
+                i = (i + 1) & mask;
+            }
+            m_slots[i] = slot;
+        }
+        m_header->count = quint32(live.size());
+    }
+
+    quint64 FrecencyStore::hashKey(const QString& key) {
+        // FNV-1a: stable across runs, unlike the seeded qHash()
+        quint64 hash = 0xcbf29ce484222325ULL;
+        for (const QChar c : key) {
+            hash ^= c.unicode();
+            hash *= 0x100000001b3ULL;
+        }
+        return hash == 0 ? 1 : hash;
+    }
+
+    quint32 FrecencyStore::nowMinutes() {
+        return quint32(QDateTime::currentSecsSinceEpoch() / 60);
+    }
+
+    double FrecencyStore::decayed(const Slot& slot, quint32 now) {
+        const double age = now > slot.lastUsed ? double(now - slot.lastUsed) : 0.0;
+        return double(slot.score) * std::exp2(-age / HalfLifeMinutes);
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QFile>
+#include <QReadWriteLock>
+#include <QString>
+
+namespace quicksearch::models {
+
+    // How often and how recently things were opened, for ranking.
+    //
+    // A small open-addressing hash table in ~/.local/share/unite/frecency.bin,
+    // mapped into memory: recording writes straight into the mapping, and a
+    // lookup is one hash plus a short probe. Keys are desktop IDs for
+    // applications and absolute paths for files, stored as 64-bit hashes.
+    //
+    // Each slot keeps a score and the time it was last updated; every use adds
+    // 1 and the score halves every week, so the value read is always decayed
+    // to now without rewriting the table.
+    //
+    // Thread safety: all members may be called from any thread.
+    class FrecencyStore {
+    public:
+        // Upper bound of boost(), relative to fuzzy scores in [0, 1]
+        static constexpr double MaxBoost = 0.3;
+
+        static FrecencyStore* instance();
+
+        // Counts one use of key now
+        void record(const QString& key);
+
+        // Decayed usage count of key, 0 if never used
+        [[nodiscard]] double score(const QString& key) const;
+
+        // Ranking bonus in [0, MaxBoost): grows quickly for the first few
+        // uses and saturates, so usage reorders comparable matches but can't
+        // lift a poor match over a good one
+        [[nodiscard]] double boost(const QString& key) const;
+
+    private:
+        FrecencyStore();
+
+        struct Header {
+            quint32 magic;
+            quint32 version;
+            quint32 capacity; // slots, a power of two
+            quint32 count;    // occupied slots
+        };
+
+        struct Slot {
+            quint64 key;      // 0 marks an empty slot
+            float score;      // as of lastUsed
+            quint32 lastUsed; // minutes since the epoch
+        };
+
+        QFile m_file;
+        Header* m_header;
+        Slot* m_slots; // null if the file couldn't be mapped; then nothing is recorded
+        mutable QReadWriteLock m_lock;
+
+        bool map(quint32 capacity, bool reset);
+        void grow();
+        [[nodiscard]] const Slot* find(quint64 key) const;
+
+        static quint64 hashKey(const QString& key);
+        static quint32 nowMinutes();
+        static double decayed(const Slot& slot, quint32 now);
+    };
+
+} // namespace quicksearch::models
@@ -1,5 +1,6 @@
 #include "fuzzysearch.hpp"
 #include <QRegularExpression>
+#include <QVarLengthArray>
 #include <QtMath>
 
 namespace quicksearch::models {
@@ -62,6 +63,98 @@ namespace quicksearch::models {
         return match(query, target).score;
     }
 
+    int FuzzySearch::approximateDistance(const QString& query, const QString& target, int maxDistance) {
+        const int m = static_cast<int>(query.length());
+        if (m == 0) {
+            return 0;
+        }
+
+        // Bit-parallel state is one 64-bit word per column
+        if (m > 64 || target.isEmpty()) {
+            return -1;
+        }
+
+        const int allowed = qMin(maxDistance, m / 3);
+        if (allowed <= 0) {
+            return -1;
+        }
+
+        const QString lowerQuery = query.toLower();
+        const QString lowerTarget = target.toLower();
+
+        // Pattern masks: bit i is set where query[i] == c
+        quint64 asciiPeq[128] = {};
+        QVarLengthArray<QPair<char16_t, quint64>, 8> otherPeq;
+        for (int i = 0; i < m; ++i) {
+            const char16_t c = lowerQuery[i].unicode();
+            if (c < 128) {
+                asciiPeq[c] |= quint64(1) << i;
+                continue;
+            }
+
+            bool found = false;
+            for (auto& pair : otherPeq) {
+                if (pair.first == c) {
+                    pair.second |= quint64(1) << i;
+                    found = true;
+                    break;
+                }
+            }
+            if (!found) {
+                otherPeq.append(qMakePair(c, quint64(1) << i));
+            }
+        }
+
+        // Myers (1999): vertical deltas of the DP column are kept as +1/-1 bit
+        // vectors (pv/mv); the last row is tracked in score. Because row 0 is
+        // never shifted in, a match may start anywhere in the target.
+        const quint64 highBit = quint64(1) << (m - 1);
+        quint64 pv = m == 64 ? ~quint64(0) : (quint64(1) << m) - 1;
+        quint64 mv = 0;
+        int score = m;
+        int best = m;
+
+        for (const QChar ch : lowerTarget) {
+            const char16_t c = ch.unicode();
+            quint64 eq = 0;
+            if (c < 128) {
+                eq = asciiPeq[c];
+            } else {
+                for (const auto& pair : std::as_const(otherPeq)) {
+                    if (pair.first == c) {
+                        eq = pair.second;
+                        break;
+                    }
+                }
+            }
+
+            const quint64 xv = eq | mv;
+            const quint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+            quint64 ph = mv | ~(xh | pv);
+            quint64 mh = pv & xh;
+
+            if (ph & highBit) {
+                ++score;
+            } else if (mh & highBit) {
+                --score;
+            }
+
+            ph <<= 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+
+            if (score < best) {
+                best = score;
+                if (best == 0) {
+                    break;
+                }
+            }
+        }
+
+        return best <= allowed ? best : -1;
+    }
+
     QVector<int> FuzzySearch::findMatchPositions(const QString& query, const QString& target) {
         QVector<int> positions;
 
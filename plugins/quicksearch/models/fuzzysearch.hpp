@@ -29,6 +29,14 @@ namespace quicksearch::models {
         // - Match position (earlier matches score higher)
         static double calculateScore(const QString& query, const QString& target);
 
+        // Typo-tolerant matching: returns the smallest number of edits
+        // (insert/delete/substitute) turning the query into some substring of
+        // target, or -1 if that exceeds maxDistance. Uses Myers' bit-parallel
+        // algorithm, so queries are limited to 64 characters. The allowed
+        // distance is capped to a third of the query length so short queries
+        // don't match everything.
+        static int approximateDistance(const QString& query, const QString& target, int maxDistance);
+
     private:
         // Helper to find all matching positions
         static QVector<int> findMatchPositions(const QString& query, const QString& target);
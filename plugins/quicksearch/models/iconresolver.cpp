@@ -0,0 +1,517 @@
+#include "iconresolver.hpp"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QIcon>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <limits>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        constexpr quint32 CacheMagic = 0x49434e55; // "UNCI"
+        constexpr quint32 CacheVersion = 1;
+
+        // Indexed by IconResolver::Extension, in the spec's order of preference
+        const char* const Suffixes[] = { ".png", ".svg", ".xpm" };
+
+        using IniGroups = QHash<QString, QHash<QString, QString>>;
+
+        // index.theme is a plain ini file; only read once per theme
+        IniGroups readIni(const QString& path) {
+            IniGroups groups;
+
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+                return groups;
+            }
+
+            QString group;
+            while (!file.atEnd()) {
+                const QString line = QString::fromUtf8(file.readLine()).trimmed();
+                if (line.isEmpty() || line.startsWith('#')) {
+                    continue;
+                }
+
+                if (line.startsWith('[') && line.endsWith(']')) {
+                    group = line.mid(1, line.length() - 2);
+                    continue;
+                }
+
+                const auto equals = line.indexOf('=');
+                if (group.isEmpty() || equals < 0) {
+                    continue;
+                }
+                groups[group].insert(line.left(equals).trimmed(), line.mid(equals + 1).trimmed());
+            }
+
+            return groups;
+        }
+
+        QStringList splitCommaList(const QString& value) {
+            QStringList items;
+            for (const QString& item : value.split(',', Qt::SkipEmptyParts)) {
+                const QString trimmed = item.trimmed();
+                if (!trimmed.isEmpty()) {
+                    items << trimmed;
+                }
+            }
+            return items;
+        }
+
+        // Index into Suffixes, or -1 for files that aren't icons
+        int suffixIndex(const QString& fileName) {
+            for (int i = 0; i < 3; ++i) {
+                if (fileName.endsWith(QLatin1String(Suffixes[i]))) {
+                    return i;
+                }
+            }
+            return -1;
+        }
+
+    } // namespace
+
+    IconResolver* IconResolver::instance() {
+        static IconResolver* resolver = [] {
+            auto* created = new IconResolver(QCoreApplication::instance());
+
+            // The theme name is only safe to read on the GUI thread
+            QString theme = QIcon::themeName();
+            if (theme.isEmpty()) {
+                theme = "hicolor";
+            }
+
+            QThreadPool::globalInstance()->start([created, theme]() {
+                created->load(theme);
+            });
+
+            return created;
+        }();
+        return resolver;
+    }
+
+    IconResolver::IconResolver(QObject* parent)
+    : QObject(parent)
+    , m_ready(false) {}
+
+    QString IconResolver::resolve(const QString& icon, int size) const {
+        if (icon.isEmpty()) {
+            return QString();
+        }
+
+        if (icon.startsWith('/')) {
+            return icon;
+        }
+
+        std::shared_ptr<const Index> index;
+        {
+            QMutexLocker locker(&m_mutex);
+            index = m_index;
+        }
+
+        if (!index) {
+            return QString();
+        }
+
+        const auto it = index->icons.constFind(icon);
+        if (it != index->icons.constEnd()) {
+            const Candidate* best = nullptr;
+            int bestDistance = std::numeric_limits<int>::max();
+
+            for (const Candidate& candidate : it.value()) {
+                const Directory& dir = index->dirs.at(candidate.dir);
+
+                // Candidates are in theme order: an earlier theme having the icon at all wins
+                if (best && dir.themeRank != index->dirs.at(best->dir).themeRank) {
+                    break;
+                }
+
+                const int distance = matchesSize(dir, size) ? 0 : sizeDistance(dir, size);
+                if (!best || distance < bestDistance ||
+                    (distance == bestDistance && candidate.extension < best->extension)) {
+                    best = &candidate;
+                    bestDistance = distance;
+                }
+            }
+
+            return index->dirs.at(best->dir).path + '/' + icon + QLatin1String(Suffixes[best->extension]);
+        }
+
+        const QString pixmap = index->pixmaps.value(icon);
+        if (!pixmap.isEmpty()) {
+            return pixmap;
+        }
+
+        // Some entries name the file, e.g. Icon=foo.png
+        const int suffix = suffixIndex(icon);
+        if (suffix >= 0) {
+            return resolve(icon.chopped(4), size);
+        }
+
+        return QString();
+    }
+
+    void IconResolver::load(const QString& theme) {
+        auto index = readCache(theme);
+        if (!index) {
+            index = build(theme);
+            writeCache(*index);
+        }
+
+        {
+            QMutexLocker locker(&m_mutex);
+            m_index = index;
+        }
+        m_ready = true;
+
+        QMetaObject::invokeMethod(this, [this]() {
+            emit ready();
+        }, Qt::QueuedConnection);
+    }
+
+    std::shared_ptr<IconResolver::Index> IconResolver::build(const QString& theme) {
+        auto index = std::make_shared<Index>();
+        index->theme = theme;
+
+        const QStringList baseDirs = iconBaseDirs();
+        for (const QString& base : baseDirs) {
+            index->stamps.append(Stamp { base, modifiedTime(base) });
+        }
+
+        // Depth-first through Inherits, as the spec's lookup does, then hicolor
+        QStringList chain;
+        QStringList pending { theme };
+        bool hicolorQueued = theme == "hicolor";
+
+        while (!pending.isEmpty()) {
+            const QString name = pending.takeFirst();
+            if (chain.contains(name)) {
+                continue;
+            }
+
+            // A theme may be spread over several base dirs; the first index.theme describes it
+            QStringList roots;
+            IniGroups ini;
+            for (const QString& base : baseDirs) {
+                const QString root = base + '/' + name;
+                if (!QFileInfo(root).isDir()) {
+                    continue;
+                }
+                roots << root;
+
+                const QString indexFile = root + "/index.theme";
+                if (ini.isEmpty() && QFileInfo::exists(indexFile)) {
+                    ini = readIni(indexFile);
+                    index->stamps.append(Stamp { indexFile, modifiedTime(indexFile) });
+                }
+            }
+
+            if (!ini.isEmpty()) {
+                chain << name;
+                const int rank = static_cast<int>(chain.size()) - 1;
+                const auto themeGroup = ini.value("Icon Theme");
+
+                QStringList subdirs = splitCommaList(themeGroup.value("Directories"));
+                for (const QString& scaled : splitCommaList(themeGroup.value("ScaledDirectories"))) {
+                    if (!subdirs.contains(scaled)) {
+                        subdirs << scaled;
+                    }
+                }
+
+                for (const QString& subdir : std::as_const(subdirs)) {
+                    const auto group = ini.value(subdir);
+                    const int size = group.value("Size").toInt();
+                    if (size <= 0) {
+                        continue; // Size is required
+                    }
+
+                    Directory dir;
+                    dir.themeRank = rank;
+                    dir.size = size;
+                    dir.minSize = group.value("MinSize", QString::number(size)).toInt();
+                    dir.maxSize = group.value("MaxSize", QString::number(size)).toInt();
+                    dir.threshold = group.value("Threshold", "2").toInt();
+                    dir.scale = qMax(1, group.value("Scale", "1").toInt());
+
+                    const QString type = group.value("Type", "Threshold");
+                    if (type == "Fixed") {
+                        dir.type = DirType::Fixed;
+                    } else if (type == "Scalable") {
+                        dir.type = DirType::Scalable;
+                    } else {
+                        dir.type = DirType::Threshold;
+                    }
+
+                    for (const QString& root : std::as_const(roots)) {
+                        dir.path = root + '/' + subdir;
+                        const qint64 modified = modifiedTime(dir.path);
+                        index->stamps.append(Stamp { dir.path, modified });
+                        if (modified < 0) {
+                            continue;
+                        }
+
+                        const auto dirIndex = static_cast<quint32>(index->dirs.size());
+                        index->dirs.append(dir);
+
+                        QDirIterator iter(dir.path, QDir::Files);
+                        while (iter.hasNext()) {
+                            iter.next();
+                            const QString fileName = iter.fileName();
+                            const int suffix = suffixIndex(fileName);
+                            if (suffix >= 0) {
+                                index->icons[fileName.chopped(4)].append(
+                                    Candidate { dirIndex, static_cast<Extension>(suffix) }
+                                );
+                            }
+                        }
+                    }
+                }
+
+                // Parents go before anything queued earlier
+                const QStringList parents = splitCommaList(themeGroup.value("Inherits"));
+                for (qsizetype i = parents.size() - 1; i >= 0; --i) {
+                    pending.prepend(parents.at(i));
+                }
+                hicolorQueued = hicolorQueued || parents.contains("hicolor");
+            }
+
+            if (pending.isEmpty() && !hicolorQueued) {
+                pending << "hicolor";
+                hicolorQueued = true;
+            }
+        }
+
+        for (const QString& dir : pixmapDirs()) {
+            const qint64 modified = modifiedTime(dir);
+            index->stamps.append(Stamp { dir, modified });
+            if (modified < 0) {
+                continue;
+            }
+
+            QDirIterator iter(dir, QDir::Files);
+            while (iter.hasNext()) {
+                const QString path = iter.next();
+                const QString fileName = iter.fileName();
+                const int suffix = suffixIndex(fileName);
+                const QString name = fileName.chopped(4);
+                if (suffix >= 0 && !index->pixmaps.contains(name)) {
+                    index->pixmaps.insert(name, path);
+                }
+            }
+        }
+
+        return index;
+    }
+
+    QString IconResolver::cachePath() {
+        return QDir::homePath() + "/.cache/unite/icon-index.bin";
+    }
+
+    std::shared_ptr<IconResolver::Index> IconResolver::readCache(const QString& theme) {
+        QFile file(cachePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            return nullptr;
+        }
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        in >> magic >> version;
+        if (magic != CacheMagic || version != CacheVersion) {
+            return nullptr;
+        }
+
+        auto index = std::make_shared<Index>();
+        in >> index->theme;
+        if (index->theme != theme) {
+            return nullptr;
+        }
+
+        // Anything that changed since the index was written means a rebuild
+        quint32 stampCount = 0;
+        in >> stampCount;
+        for (quint32 i = 0; i < stampCount && in.status() == QDataStream::Ok; ++i) {
+            Stamp stamp;
+            in >> stamp.path >> stamp.modified;
+            if (modifiedTime(stamp.path) != stamp.modified) {
+                return nullptr;
+            }
+            index->stamps.append(stamp);
+        }
+
+        quint32 dirCount = 0;
+        in >> dirCount;
+        for (quint32 i = 0; i < dirCount && in.status() == QDataStream::Ok; ++i) {
+            Directory dir;
+            qint32 rank, size, minSize, maxSize, threshold, scale;
+            quint8 type;
+            in >> dir.path >> rank >> size >> minSize >> maxSize >> threshold >> scale >> type;
+            dir.themeRank = rank;
+            dir.size = size;
+            dir.minSize = minSize;
+            dir.maxSize = maxSize;
+            dir.threshold = threshold;
+            dir.scale = scale;
+            dir.type = static_cast<DirType>(type);
+            index->dirs.append(dir);
+        }
+
+        quint32 iconCount = 0;
+        in >> iconCount;
+        index->icons.reserve(iconCount);
+        for (quint32 i = 0; i < iconCount && in.status() == QDataStream::Ok; ++i) {
+            QString name;
+            quint32 candidateCount = 0;
+            in >> name >> candidateCount;
+
+            QVector<Candidate>& candidates = index->icons[name];
+            for (quint32 c = 0; c < candidateCount && in.status() == QDataStream::Ok; ++c) {
+                quint32 dir = 0;
+                quint8 extension = 0;
+                in >> dir >> extension;
+                if (dir >= quint32(index->dirs.size()) || extension > Xpm) {
+                    return nullptr;
+                }
+                candidates.append(Candidate { dir, static_cast<Extension>(extension) });
+            }
+        }
+
+        in >> index->pixmaps;
+
+        if (in.status() != QDataStream::Ok) {
+            return nullptr;
+        }
+        return index;
+    }
+
+    void IconResolver::writeCache(const Index& index) {
+        const QString path = cachePath();
+        QDir().mkpath(QFileInfo(path).absolutePath());
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return;
+        }
+
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_6_0);
+
+        out << CacheMagic << CacheVersion << index.theme;
+
+        out << quint32(index.stamps.size());
+        for (const Stamp& stamp : index.stamps) {
+            out << stamp.path << stamp.modified;
+        }
+
+        out << quint32(index.dirs.size());
+        for (const Directory& dir : index.dirs) {
+            out << dir.path << qint32(dir.themeRank) << qint32(dir.size) << qint32(dir.minSize)
+                << qint32(dir.maxSize) << qint32(dir.threshold) << qint32(dir.scale) << quint8(dir.type);
+        }
+
+        out << quint32(index.icons.size());
+        for (auto it = index.icons.cbegin(); it != index.icons.cend(); ++it) {
+            out << it.key() << quint32(it->size());
+            for (const Candidate& candidate : it.value()) {
+                out << candidate.dir << quint8(candidate.extension);
+            }
+        }
+
+        out << index.pixmaps;
+
+        file.commit();
+    }
+
+    QStringList IconResolver::iconBaseDirs() {
+        QStringList dirs { QDir::homePath() + "/.icons" };
+
+        QString dataHome = qEnvironmentVariable("XDG_DATA_HOME");
+        if (dataHome.isEmpty()) {
+            dataHome = QDir::homePath() + "/.local/share";
+        }
+        dirs << dataHome + "/icons";
+
+        QString dataDirs = qEnvironmentVariable("XDG_DATA_DIRS");
+        if (dataDirs.isEmpty()) {
+            dataDirs = "/usr/local/share:/usr/share";
+        }
+        for (const QString& dir : dataDirs.split(':', Qt::SkipEmptyParts)) {
+            dirs << dir + "/icons";
+        }
+
+        dirs.removeDuplicates();
+        return dirs;
+    }
+
+    QStringList IconResolver::pixmapDirs() {
+        QString dataDirs = qEnvironmentVariable("XDG_DATA_DIRS");
+        if (dataDirs.isEmpty()) {
+            dataDirs = "/usr/local/share:/usr/share";
+        }
+
+        QStringList dirs;
+        for (const QString& dir : dataDirs.split(':', Qt::SkipEmptyParts)) {
+            dirs << dir + "/pixmaps";
+        }
+
+        dirs.removeDuplicates();
+        return dirs;
+    }
+
+    qint64 IconResolver::modifiedTime(const QString& path) {
+        const QFileInfo info(path);
+        return info.exists() ? info.lastModified().toMSecsSinceEpoch() : -1;
+    }
+
+    bool IconResolver::matchesSize(const Directory& dir, int size) {
+        if (dir.scale != 1) {
+            return false;
+        }
+
+        switch (dir.type) {
+        case DirType::Fixed:
+            return dir.size == size;
+        case DirType::Scalable:
+            return dir.minSize <= size && size <= dir.maxSize;
+        case DirType::Threshold:
+            return dir.size - dir.threshold <= size && size <= dir.size + dir.threshold;
+        }
+
+        return false;
+    }
+
+    int IconResolver::sizeDistance(const Directory& dir, int size) {
+        switch (dir.type) {
+        case DirType::Fixed:
+            return qAbs(dir.size * dir.scale - size);
+        case DirType::Scalable:
+            if (size < dir.minSize * dir.scale) {
+                return dir.minSize * dir.scale - size;
+            }
+            if (size > dir.maxSize * dir.scale) {
+                return size - dir.maxSize * dir.scale;
+            }
+            return 0;
+        case DirType::Threshold:
+            if (size < (dir.size - dir.threshold) * dir.scale) {
+                return (dir.size - dir.threshold) * dir.scale - size;
+            }
+            if (size > (dir.size + dir.threshold) * dir.scale) {
+                return size - (dir.size + dir.threshold) * dir.scale;
+            }
+            return 0;
+        }
+
+        return std::numeric_limits<int>::max();
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+namespace quicksearch::models {
+
+    // Resolves freedesktop icon names to files without touching the disk per lookup.
+    //
+    // The current theme's index.theme files are parsed once, following Inherits
+    // down to hicolor, and every icon directory they list is read on a worker
+    // into a single name -> candidates index (plus /usr/share/pixmaps). The
+    // index is persisted to ~/.cache/unite/icon-index.bin and reused as long as
+    // the theme and the modification times of every directory it read match.
+    //
+    // instance() must first be called from the GUI thread. Until ready() has
+    // been emitted, resolve() returns an empty string.
+    class IconResolver : public QObject {
+        Q_OBJECT
+
+    public:
+        // Size looked up when the caller doesn't ask for one; dash tiles are about this big
+        static constexpr int DefaultSize = 128;
+
+        static IconResolver* instance();
+
+        [[nodiscard]] bool isReady() const { return m_ready; }
+
+        // File for an Icon= value, following the Icon Theme spec lookup: the
+        // first theme in the inheritance chain that has the icon wins, and
+        // within it the directory closest to the requested size. Absolute
+        // paths are returned as-is. Empty if not found or not ready yet.
+        [[nodiscard]] QString resolve(const QString& icon, int size = DefaultSize) const;
+
+    signals:
+        void ready();
+
+    private:
+        explicit IconResolver(QObject* parent = nullptr);
+
+        enum class DirType : quint8 {
+            Fixed,
+            Scalable,
+            Threshold
+        };
+
+        enum Extension : quint8 {
+            Png,
+            Svg,
+            Xpm
+        };
+
+        struct Directory {
+            QString path;
+            int themeRank = 0; // position in the inheritance chain
+            int size = 0;
+            int minSize = 0;
+            int maxSize = 0;
+            int threshold = 2;
+            int scale = 1;
+            DirType type = DirType::Threshold;
+        };
+
+        struct Candidate {
+            quint32 dir;
+            Extension extension;
+        };
+
+        struct Stamp {
+            QString path;
+            qint64 modified; // -1 if it didn't exist
+        };
+
+        struct Index {
+            QString theme;
+            QVector<Directory> dirs;
+            QHash<QString, QVector<Candidate>> icons; // candidates in theme order
+            QHash<QString, QString> pixmaps;          // unthemed fallbacks
+            QVector<Stamp> stamps;                    // everything the index was read from
+        };
+
+        mutable QMutex m_mutex; // guards m_index
+        std::shared_ptr<const Index> m_index;
+        std::atomic_bool m_ready;
+
+        void load(const QString& theme);
+
+        static std::shared_ptr<Index> build(const QString& theme);
+        static std::shared_ptr<Index> readCache(const QString& theme);
+        static void writeCache(const Index& index);
+        static QString cachePath();
+
+        static QStringList iconBaseDirs();
+        static QStringList pixmapDirs();
+        static qint64 modifiedTime(const QString& path);
+        static bool matchesSize(const Directory& dir, int size);
+        static int sizeDistance(const Directory& dir, int size);
+    };
+
+} // namespace quicksearch::models
@@ -0,0 +1,293 @@
+#include "imageprobe.hpp"
+
+#include <QFile>
+#include <QImageReader>
+#include <QSet>
+#include <QtEndian>
+#include <cstring>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        constexpr qint64 HeaderBytes = 4 * 1024;
+
+        // Exif segments are limited to 64 KiB by the JPEG segment length
+        constexpr qint64 MaxSegment = 64 * 1024;
+
+        // Suffixes of formats we know a signature for; such files without it
+        // aren't images whatever their name says
+        const QSet<QString> SignedSuffixes = {
+            "jpg", "jpeg", "jpe", "jfif", "png", "gif", "bmp", "dib", "webp", "tif", "tiff",
+            "qoi", "pbm", "pgm", "ppm", "pnm", "avif", "heic", "heif", "ico", "cur", "svg",
+        };
+
+        quint16 readU16(const uchar* p, bool bigEndian) {
+            return bigEndian ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
+        }
+
+        quint32 readU32(const uchar* p, bool bigEndian) {
+            return bigEndian ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
+        }
+
+        QString suffixOf(const QString& name) {
+            const qsizetype dot = name.lastIndexOf('.');
+            return dot < 0 ? QString() : name.mid(dot + 1).toLower();
+        }
+
+        // Walks a TIFF structure's IFD0 for width, height and orientation.
+        // tiff points at the byte-order mark; length bytes of it are available.
+        void readTiffIfd0(const uchar* tiff, qint64 length, ImageInfo* info) {
+            if (length < 8) {
+                return;
+            }
+            const bool bigEndian = tiff[0] == 'M';
+            const quint32 offset = readU32(tiff + 4, bigEndian);
+            if (quint64(offset) + 2 > quint64(length)) {
+                return;
+            }
+
+            const quint16 count = readU16(tiff + offset, bigEndian);
+            int width = 0;
+            int height = 0;
+            for (quint16 i = 0; i < count; ++i) {
+                const quint64 at = quint64(offset) + 2 + quint64(i) * 12;
+                if (at + 12 > quint64(length)) {
+                    break;
+                }
+                const uchar* entry = tiff + at;
+                const quint16 tag = readU16(entry, bigEndian);
+                const quint16 type = readU16(entry + 2, bigEndian);
+                const quint32 value = type == 3 ? readU16(entry + 8, bigEndian) : readU32(entry + 8, bigEndian);
+                if (tag == 0x0100) {
+                    width = int(value);
+                } else if (tag == 0x0101) {
+                    height = int(value);
+                } else if (tag == 0x0112 && value >= 1 && value <= 8) {
+                    info->orientation = int(value);
+                }
+            }
+            if (width > 0 && height > 0) {
+                info->size = QSize(width, height);
+            }
+        }
+
+        // Follows the JPEG markers to the frame header, seeking over segments
+        // that don't matter and reading the Exif one for the orientation
+        void probeJpeg(QFile& file, ImageInfo* info) {
+            qint64 pos = 2;
+            for (int markers = 0; markers < 64; ++markers) {
+                if (!file.seek(pos)) {
+                    return;
+                }
+                const QByteArray header = file.read(4);
+                if (header.size() < 4 || uchar(header.at(0)) != 0xff) {
+                    return;
+                }
+                const auto* head = reinterpret_cast<const uchar*>(header.constData());
+                const uchar marker = head[1];
+
+                // Fill bytes and markers without a length
+                if (marker == 0xff) {
+                    pos += 1;
+                    continue;
+                }
+                if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd7)) {
+                    pos += 2;
+                    continue;
+                }
+                if (marker == 0xd9 || marker == 0xda) {
+                    return; // End of image or start of scan: no frame header found
+                }
+
+                const quint16 length = qFromBigEndian<quint16>(head + 2);
+                if (length < 2) {
+                    return;
+                }
+
+                // SOF0-15, except DHT (c4), JPG (c8) and DAC (cc)
+                const bool isFrame = marker >= 0xc0 && marker <= 0xcf && marker != 0xc4 && marker != 0xc8 &&
+                                     marker != 0xcc;
+                if (isFrame) {
+                    const QByteArray frame = file.read(5);
+                    if (frame.size() == 5) {
+                        const auto* data = reinterpret_cast<const uchar*>(frame.constData());
+                        info->size = QSize(qFromBigEndian<quint16>(data + 3), qFromBigEndian<quint16>(data + 1));
+                    }
+                    return;
+                }
+
+                if (marker == 0xe1 && length > 8) {
+                    const QByteArray segment = file.read(qMin<qint64>(length - 2, MaxSegment));
+                    if (segment.startsWith(QByteArray("Exif\0\0", 6))) {
+                        readTiffIfd0(reinterpret_cast<const uchar*>(segment.constData()) + 6, segment.size() - 6, info);
+                        info->size = QSize(); // IFD0 sizes are optional and often wrong; the frame decides
+                    }
+                }
+
+                pos += 2 + length;
+            }
+        }
+
+        // Reads "<width> <height>" after a PNM magic, skipping comments
+        void probePnm(const QByteArray& header, ImageInfo* info) {
+            int fields[2] = { 0, 0 };
+            qsizetype pos = 2;
+            for (int& field : fields) {
+                for (;;) {
+                    while (pos < header.size() && QChar::isSpace(uchar(header.at(pos)))) {
+                        ++pos;
+                    }
+                    if (pos < header.size() && header.at(pos) == '#') {
+                        pos = header.indexOf('\n', pos);
+                        if (pos < 0) {
+                            return;
+                        }
+                        continue;
+                    }
+                    break;
+                }
+                const qsizetype start = pos;
+                while (pos < header.size() && header.at(pos) >= '0' && header.at(pos) <= '9') {
+                    field = field * 10 + (header.at(pos) - '0');
+                    ++pos;
+                }
+                if (pos == start) {
+                    return;
+                }
+            }
+            info->size = QSize(fields[0], fields[1]);
+        }
+
+        // Recognizes the format from the first bytes, filling in what the
+        // header says. Returns false for no known signature.
+        bool sniff(QFile& file, const QByteArray& header, ImageInfo* info) {
+            const auto* data = reinterpret_cast<const uchar*>(header.constData());
+            const qsizetype length = header.size();
+
+            if (length >= 3 && data[0] == 0xff && data[1] == 0xd8 && data[2] == 0xff) {
+                info->format = "jpeg";
+                probeJpeg(file, info);
+                return true;
+            }
+            if (length >= 24 && std::memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+                info->format = "png";
+                if (std::memcmp(data + 12, "IHDR", 4) == 0) {
+                    info->size = QSize(int(qFromBigEndian<quint32>(data + 16)), int(qFromBigEndian<quint32>(data + 20)));
+                }
+                return true;
+            }
+            if (length >= 10 && (header.startsWith("GIF87a") || header.startsWith("GIF89a"))) {
+                info->format = "gif";
+                info->size = QSize(qFromLittleEndian<quint16>(data + 6), qFromLittleEndian<quint16>(data + 8));
+                return true;
+            }
+            if (length >= 26 && header.startsWith("BM")) {
+                info->format = "bmp";
+                const quint32 dibSize = qFromLittleEndian<quint32>(data + 14);
+                if (dibSize == 12) {
+                    info->size = QSize(qFromLittleEndian<quint16>(data + 18), qFromLittleEndian<quint16>(data + 20));
+                } else {
+                    // Negative heights mean top-down rows
+                    info->size = QSize(qAbs(qFromLittleEndian<qint32>(data + 18)), qAbs(qFromLittleEndian<qint32>(data + 22)));
+                }
+                return true;
+            }
+            if (length >= 30 && header.startsWith("RIFF") && std::memcmp(data + 8, "WEBP", 4) == 0) {
+                info->format = "webp";
+                if (std::memcmp(data + 12, "VP8 ", 4) == 0) {
+                    info->size = QSize(qFromLittleEndian<quint16>(data + 26) & 0x3fff,
+                                       qFromLittleEndian<quint16>(data + 28) & 0x3fff);
+                } else if (std::memcmp(data + 12, "VP8L", 4) == 0) {
+                    const quint32 bits = qFromLittleEndian<quint32>(data + 21);
+                    info->size = QSize(int(bits & 0x3fff) + 1, int((bits >> 14) & 0x3fff) + 1);
+                } else if (std::memcmp(data + 12, "VP8X", 4) == 0) {
+                    const auto read24 = [data](qsizetype at) {
+                        return int(data[at] | (data[at + 1] << 8) | (data[at + 2] << 16)) + 1;
+                    };
+                    info->size = QSize(read24(24), read24(27));
+                }
+                return true;
+            }
+            if (length >= 8 && (header.startsWith(QByteArray("II*\0", 4)) || header.startsWith(QByteArray("MM\0*", 4)))) {
+                info->format = "tiff";
+                readTiffIfd0(data, length, info);
+                return true;
+            }
+            if (length >= 14 && header.startsWith("qoif")) {
+                info->format = "qoi";
+                info->size = QSize(int(qFromBigEndian<quint32>(data + 4)), int(qFromBigEndian<quint32>(data + 8)));
+                return true;
+            }
+            if (length >= 3 && data[0] == 'P' && data[1] >= '1' && data[1] <= '6' && QChar::isSpace(data[2])) {
+                info->format = data[1] == '1' || data[1] == '4' ? "pbm" : data[1] == '2' || data[1] == '5' ? "pgm" : "ppm";
+                probePnm(header, info);
+                return true;
+            }
+            if (length >= 12 && std::memcmp(data + 4, "ftyp", 4) == 0) {
+                const QByteArray brand = header.mid(8, 4);
+                if (brand == "avif" || brand == "avis") {
+                    info->format = "avif";
+                    return true;
+                }
+                if (brand == "heic" || brand == "heix" || brand == "mif1" || brand == "msf1") {
+                    info->format = "heif";
+                    return true;
+                }
+                return false;
+            }
+            if (length >= 6 && data[0] == 0 && data[1] == 0 && (data[2] == 1 || data[2] == 2) && data[3] == 0) {
+                info->format = data[2] == 1 ? "ico" : "cur";
+                return true;
+            }
+            if (header.contains("<svg")) {
+                info->format = "svg";
+                return true;
+            }
+            return false;
+        }
+
+    } // namespace
+
+    QSize ImageInfo::orientedSize() const {
+        // 5-8 turn the image a quarter
+        return orientation >= 5 ? size.transposed() : size;
+    }
+
+    bool ImageProbe::hasImageSuffix(const QString& name) {
+        static const QSet<QString> suffixes = []() {
+            QSet<QString> result;
+            const auto formats = QImageReader::supportedImageFormats();
+            for (const auto& format : formats) {
+                result << QString::fromLatin1(format).toLower();
+            }
+            return result;
+        }();
+        return suffixes.contains(suffixOf(name));
+    }
+
+    ImageInfo ImageProbe::probe(const QString& path) {
+        ImageInfo info;
+        if (!hasImageSuffix(path)) {
+            return info;
+        }
+
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return info;
+        }
+
+        const QByteArray header = file.read(HeaderBytes);
+        if (sniff(file, header, &info)) {
+            return info;
+        }
+
+        info = ImageInfo();
+        const QString suffix = suffixOf(path);
+        if (!SignedSuffixes.contains(suffix)) {
+            info.format = suffix.toLatin1();
+        }
+        return info;
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QByteArray>
+#include <QSize>
+#include <QString>
+
+namespace quicksearch::models {
+
+    // What an image's header says about it
+    struct ImageInfo {
+        QByteArray format;   // "jpeg", "png", ...; empty if not an image we can show
+        QSize size;          // as stored; invalid if the header doesn't say
+        int orientation = 1; // EXIF orientation, 1-8
+
+        [[nodiscard]] bool isImage() const { return !format.isEmpty(); }
+
+        // Size as displayed, with the orientation's quarter turns applied
+        [[nodiscard]] QSize orientedSize() const;
+    };
+
+    // Recognizes images from their name and first bytes, without decoding.
+    //
+    // Only the header is read, usually the first 4 KiB: JPEG markers up to
+    // the frame header (and the Exif orientation on the way), PNG IHDR, GIF,
+    // BMP, WebP (VP8, VP8L and VP8X), TIFF IFD0, QOI and PNM dimensions. AVIF,
+    // HEIF, ICO and SVG are recognized by their signature only.
+    //
+    // This stands in for QImageReader::canRead(), which opens the file and
+    // asks every plugin in turn.
+    //
+    // Blocks; meant for worker threads.
+    class ImageProbe {
+    public:
+        // Whether Qt has a decoder for files with this name's suffix
+        static bool hasImageSuffix(const QString& name);
+
+        // Files whose suffix promises a format with a signature must carry
+        // one; formats without a signature (TGA, ...) are taken on their suffix.
+        static ImageInfo probe(const QString& path);
+    };
+
+} // namespace quicksearch::models
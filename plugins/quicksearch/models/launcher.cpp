@@ -0,0 +1,387 @@
+#include "launcher.hpp"
+#include "desktopentry.hpp"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJSEngine>
+#include <QProcess>
+#include <QSocketNotifier>
+#include <QStandardPaths>
+#include <csignal>
+#include <cstring>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char** environ;
+
+namespace quicksearch::models {
+
+    namespace {
+
+        // Launches that never show a window stop being tracked after this
+        constexpr qint64 FirstWindowTimeoutNs = 60LL * 1000 * 1000 * 1000;
+
+        double toMs(qint64 ns) {
+            return static_cast<double>(ns) / 1e6;
+        }
+
+        // %f wants a path, %u may get either; remote URLs are passed as-is
+        QString urlArgument(const QUrl& url) {
+            return url.isLocalFile() ? url.toLocalFile() : url.toString(QUrl::FullyEncoded);
+        }
+
+    } // namespace
+
+    Launcher* Launcher::instance() {
+        static Launcher* launcher = new Launcher(QCoreApplication::instance());
+        return launcher;
+    }
+
+    Launcher* Launcher::create(QQmlEngine*, QJSEngine*) {
+        auto* launcher = instance();
+        QJSEngine::setObjectOwnership(launcher, QJSEngine::CppOwnership);
+        return launcher;
+    }
+
+    Launcher::Launcher(QObject* parent)
+    : QObject(parent) {
+        // Separate from the global pool so a click never queues behind indexing
+        m_pool.setMaxThreadCount(2);
+        m_clock.start();
+
+        m_reapTimer.setInterval(1000);
+        connect(&m_reapTimer, &QTimer::timeout, this, &Launcher::reapChildren);
+    }
+
+    LaunchRequest Launcher::requestFor(const QString& desktopFile, const DesktopEntryData& data) {
+        LaunchRequest request;
+        request.desktopId = data.id;
+        request.desktopFile = desktopFile;
+        request.name = data.name;
+        request.icon = data.icon;
+        request.exec = data.execString;
+        request.workingDirectory = data.workingDirectory;
+        request.startupClass = data.startupClass;
+        request.runInTerminal = data.runInTerminal;
+        return request;
+    }
+
+    void Launcher::launch(const LaunchRequest& request) {
+        const qint64 requestedAt = m_clock.nsecsElapsed();
+
+        // Anonymous launches (xdg-open for files) aren't measured
+        if (!request.desktopId.isEmpty()) {
+            // Names the first window may carry: StartupWMClass, the desktop ID, and
+            // its last reverse-DNS component (org.gnome.Nautilus -> nautilus)
+            PendingWindow pending { request.desktopId, {}, requestedAt };
+            QString baseId = request.desktopId;
+            if (baseId.endsWith(QLatin1String(".desktop"))) {
+                baseId.chop(8);
+            }
+            for (const QString& appId : { request.startupClass, baseId, baseId.section('.', -1) }) {
+                if (!appId.isEmpty() && !pending.appIds.contains(appId.toLower())) {
+                    pending.appIds << appId.toLower();
+                }
+            }
+            m_pendingWindows.append(pending);
+        }
+
+        m_pool.start([this, request, requestedAt]() {
+            QStringList argv = expandExec(request);
+
+            QString error;
+            pid_t pid = -1;
+            if (argv.isEmpty()) {
+                error = "empty command";
+            } else {
+                if (request.runInTerminal) {
+                    const QStringList terminal = terminalCommand();
+                    if (terminal.isEmpty()) {
+                        qWarning() << "No terminal emulator found, launching without one:" << request.desktopId;
+                    } else {
+                        argv = terminal + argv;
+                    }
+                }
+
+                const QString workDir = request.workingDirectory.isEmpty() ? QDir::homePath()
+                                                                          : request.workingDirectory;
+                pid = spawn(argv, workDir, error);
+            }
+
+            const qint64 spawnedAt = m_clock.nsecsElapsed();
+            QMetaObject::invokeMethod(this, [this, desktopId = request.desktopId, pid, requestedAt, spawnedAt, error]() {
+                onSpawned(desktopId, pid, requestedAt, spawnedAt, error);
+            }, Qt::QueuedConnection);
+        });
+    }
+
+    void Launcher::onSpawned(const QString& desktopId, pid_t pid, qint64 requestedAt, qint64 spawnedAt,
+                             const QString& error) {
+        if (pid <= 0) {
+            m_pendingWindows.removeIf([&](const PendingWindow& pending) {
+                return pending.requestedAt == requestedAt && pending.desktopId == desktopId;
+            });
+
+            qWarning() << "Failed to execute:" << desktopId << error;
+            emit launchFailed(desktopId, error);
+            return;
+        }
+
+        watchChild(pid);
+
+        if (desktopId.isEmpty()) {
+            return;
+        }
+
+        const double spawnMs = toMs(spawnedAt - requestedAt);
+        Stats& stats = m_stats[desktopId];
+        ++stats.launches;
+        stats.lastSpawnMs = spawnMs;
+        stats.totalSpawnMs += spawnMs;
+
+        emit launched(desktopId, spawnMs);
+    }
+
+    void Launcher::windowOpened(const QString& appId) {
+        if (appId.isEmpty() || m_pendingWindows.isEmpty()) {
+            return;
+        }
+
+        const qint64 now = m_clock.nsecsElapsed();
+        m_pendingWindows.removeIf([now](const PendingWindow& pending) {
+            return now - pending.requestedAt > FirstWindowTimeoutNs;
+        });
+
+        const QString folded = appId.toLower();
+        for (qsizetype i = 0; i < m_pendingWindows.size(); ++i) {
+            const PendingWindow& pending = m_pendingWindows.at(i);
+            if (!pending.appIds.contains(folded)) {
+                continue;
+            }
+
+            const double firstWindowMs = toMs(now - pending.requestedAt);
+            Stats& stats = m_stats[pending.desktopId];
+            ++stats.windows;
+            stats.lastFirstWindowMs = firstWindowMs;
+            stats.totalFirstWindowMs += firstWindowMs;
+
+            const QString desktopId = pending.desktopId;
+            m_pendingWindows.removeAt(i);
+            emit windowShown(desktopId, firstWindowMs);
+            return;
+        }
+    }
+
+    QVariantMap Launcher::stats(const QString& desktopId) const {
+        const auto it = m_stats.constFind(desktopId);
+        if (it == m_stats.constEnd()) {
+            return QVariantMap();
+        }
+
+        return QVariantMap {
+            { "launches", it->launches },
+            { "lastSpawnMs", it->lastSpawnMs },
+            { "averageSpawnMs", it->launches > 0 ? it->totalSpawnMs / it->launches : 0.0 },
+            { "windows", it->windows },
+            { "lastFirstWindowMs", it->lastFirstWindowMs },
+            { "averageFirstWindowMs", it->windows > 0 ? it->totalFirstWindowMs / it->windows : 0.0 },
+        };
+    }
+
+    QStringList Launcher::expandExec(const LaunchRequest& request) {
+        QStringList args;
+
+        for (const QString& token : DesktopEntryParser::splitExecString(request.exec)) {
+            // Codes that expand to a list are only valid as a whole argument
+            if (token == QLatin1String("%F") || token == QLatin1String("%U")) {
+                for (const QUrl& url : request.urls) {
+                    if (token == QLatin1String("%U")) {
+                        args << urlArgument(url);
+                    } else if (url.isLocalFile()) {
+                        args << url.toLocalFile();
+                    }
+                }
+                continue;
+            }
+
+            if (token == QLatin1String("%i")) {
+                if (!request.icon.isEmpty()) {
+                    args << "--icon" << request.icon;
+                }
+                continue;
+            }
+
+            // Single-value codes may be embedded, e.g. --file=%f. With several
+            // URLs for a single-value code we pass the first one.
+            QString arg;
+            for (qsizetype i = 0; i < token.length(); ++i) {
+                const QChar c = token.at(i);
+                if (c != '%' || i + 1 == token.length()) {
+                    arg += c;
+                    continue;
+                }
+
+                switch (token.at(++i).unicode()) {
+                case '%':
+                    arg += '%';
+                    break;
+                case 'f':
+                    for (const QUrl& url : request.urls) {
+                        if (url.isLocalFile()) {
+                            arg += url.toLocalFile();
+                            break;
+                        }
+                    }
+                    break;
+                case 'u':
+                    if (!request.urls.isEmpty()) {
+                        arg += urlArgument(request.urls.first());
+                    }
+                    break;
+                case 'c':
+                    arg += request.name;
+                    break;
+                case 'k':
+                    arg += request.desktopFile;
+                    break;
+                default:
+                    break; // Deprecated (%d %D %n %N %v %m) or misplaced codes are dropped
+                }
+            }
+
+            if (!arg.isEmpty()) {
+                args << arg;
+            }
+        }
+
+        return args;
+    }
+
+    QStringList Launcher::terminalCommand() {
+        static const QStringList command = [] {
+            const QStringList fromEnv = QProcess::splitCommand(qEnvironmentVariable("TERMINAL"));
+            if (!fromEnv.isEmpty()) {
+                const QString program = QStandardPaths::findExecutable(fromEnv.first());
+                if (!program.isEmpty()) {
+                    return QStringList { program } + fromEnv.mid(1) + QStringList { "-e" };
+                }
+            }
+
+            // Terminal and the arguments that make it run a command
+            const QList<QStringList> known = {
+                { "xdg-terminal-exec" },
+                { "kgx", "--" },
+                { "gnome-terminal", "--" },
+                { "konsole", "-e" },
+                { "alacritty", "-e" },
+                { "kitty" },
+                { "foot" },
+                { "wezterm", "start", "--" },
+                { "xterm", "-e" },
+            };
+
+            for (const QStringList& terminal : known) {
+                const QString program = QStandardPaths::findExecutable(terminal.first());
+                if (!program.isEmpty()) {
+                    return QStringList { program } + terminal.mid(1);
+                }
+            }
+
+            return QStringList();
+        }();
+
+        return command;
+    }
+
+    pid_t Launcher::spawn(const QStringList& argv, const QString& workingDirectory, QString& error) {
+        QList<QByteArray> encoded;
+        encoded.reserve(argv.size());
+        for (const QString& arg : argv) {
+            encoded << QFile::encodeName(arg);
+        }
+
+        std::vector<char*> args;
+        args.reserve(encoded.size() + 1);
+        for (QByteArray& arg : encoded) {
+            args.push_back(arg.data());
+        }
+        args.push_back(nullptr);
+
+        posix_spawn_file_actions_t fileActions;
+        posix_spawn_file_actions_init(&fileActions);
+        const QByteArray dir = QFile::encodeName(workingDirectory);
+        posix_spawn_file_actions_addchdir_np(&fileActions, dir.constData());
+
+        // Own session, clean signal state: nothing of ours leaks into the app
+        posix_spawnattr_t attributes;
+        posix_spawnattr_init(&attributes);
+        short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+        flags |= POSIX_SPAWN_SETSID;
+#endif
+        posix_spawnattr_setflags(&attributes, flags);
+
+        sigset_t signals;
+        sigemptyset(&signals);
+        posix_spawnattr_setsigmask(&attributes, &signals);
+        sigfillset(&signals);
+        posix_spawnattr_setsigdefault(&attributes, &signals);
+
+        pid_t pid = -1;
+        const int result = posix_spawnp(&pid, args.front(), &fileActions, &attributes, args.data(), environ);
+
+        posix_spawnattr_destroy(&attributes);
+        posix_spawn_file_actions_destroy(&fileActions);
+
+        if (result != 0) {
+            error = QString::fromLocal8Bit(std::strerror(result));
+            return -1;
+        }
+        return pid;
+    }
+
+    void Launcher::watchChild(pid_t pid) {
+#ifdef SYS_pidfd_open
+        // Readable once the child exits (or already has), so nothing polls while
+        // apps run, and no SIGCHLD handler competes with QProcess's
+        const int fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+        if (fd >= 0) {
+            auto* notifier = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+            connect(notifier, &QSocketNotifier::activated, this, [pid, fd, notifier]() {
+                notifier->setEnabled(false);
+                waitpid(pid, nullptr, WNOHANG);
+                ::close(fd);
+                notifier->deleteLater();
+            });
+            return;
+        }
+#endif
+
+        // Linux before 5.3
+        m_children.insert(pid);
+        if (!m_reapTimer.isActive()) {
+            m_reapTimer.start();
+        }
+    }
+
+    void Launcher::reapChildren() {
+        for (auto it = m_children.begin(); it != m_children.end();) {
+            const pid_t result = waitpid(*it, nullptr, WNOHANG);
+            if (result == 0) {
+                ++it;
+            } else {
+                it = m_children.erase(it); // Exited, or not ours to wait for any more
+            }
+        }
+
+        if (m_children.isEmpty()) {
+            m_reapTimer.stop();
+        }
+    }
+
+} // namespace quicksearch::models
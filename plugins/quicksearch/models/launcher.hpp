@@ -0,0 +1,109 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <QUrl>
+#include <QVariantMap>
+#include <qqmlintegration.h>
+#include <sys/types.h>
+
+class QQmlEngine;
+class QJSEngine;
+
+namespace quicksearch::models {
+
+    struct DesktopEntryData;
+
+    // Everything needed to start one desktop entry (or one of its actions)
+    struct LaunchRequest {
+        QString desktopId;
+        QString desktopFile;      // for %k
+        QString name;             // for %c
+        QString icon;             // for %i
+        QString exec;             // unexpanded Exec value
+        QString workingDirectory; // home if empty
+        QString startupClass;     // matched against window app IDs
+        bool runInTerminal = false;
+        QList<QUrl> urls;         // for %f %F %u %U
+    };
+
+    // Starts applications without blocking the GUI thread.
+    //
+    // Field codes are expanded, Terminal=true entries are wrapped in a terminal
+    // emulator, and the process is started with posix_spawn on a small
+    // dedicated pool, in its own session. Each child is reaped as soon as its
+    // pidfd reports that it exited; kernels without pidfds fall back to a timer.
+    //
+    // Launch latency is tracked per desktop ID: spawn latency from launch()
+    // until the process exists, and first-window latency until QML reports a
+    // toplevel with a matching app ID through windowOpened().
+    class Launcher : public QObject {
+        Q_OBJECT
+        QML_ELEMENT
+        QML_SINGLETON
+
+    public:
+        static Launcher* instance();
+        static Launcher* create(QQmlEngine* qmlEngine, QJSEngine* jsEngine);
+
+        static LaunchRequest requestFor(const QString& desktopFile, const DesktopEntryData& data);
+
+        void launch(const LaunchRequest& request);
+
+        // Call when a toplevel window appears (or gets its app ID)
+        Q_INVOKABLE void windowOpened(const QString& appId);
+
+        // Launch statistics for a desktop ID: launches, lastSpawnMs, averageSpawnMs,
+        // windows, lastFirstWindowMs, averageFirstWindowMs. Empty if never launched.
+        Q_INVOKABLE QVariantMap stats(const QString& desktopId) const;
+
+        // Exec value with field codes expanded, as an argument vector
+        static QStringList expandExec(const LaunchRequest& request);
+
+    signals:
+        void launched(const QString& desktopId, double spawnMs);
+        void launchFailed(const QString& desktopId, const QString& error);
+        void windowShown(const QString& desktopId, double firstWindowMs);
+
+    private:
+        explicit Launcher(QObject* parent = nullptr);
+
+        struct Stats {
+            int launches = 0;
+            double lastSpawnMs = 0;
+            double totalSpawnMs = 0;
+            int windows = 0;
+            double lastFirstWindowMs = 0;
+            double totalFirstWindowMs = 0;
+        };
+
+        struct PendingWindow {
+            QString desktopId;
+            QStringList appIds; // lowercased names the window may report
+            qint64 requestedAt; // ns on m_clock
+        };
+
+        QThreadPool m_pool;
+        QElapsedTimer m_clock;
+        QTimer m_reapTimer;
+
+        QSet<pid_t> m_children; // polled by m_reapTimer, without pidfds only
+        QList<PendingWindow> m_pendingWindows;
+        QHash<QString, Stats> m_stats;
+
+        void onSpawned(const QString& desktopId, pid_t pid, qint64 requestedAt, qint64 spawnedAt, const QString& error);
+        void watchChild(pid_t pid);
+        void reapChildren();
+
+        static QStringList terminalCommand();
+        static pid_t spawn(const QStringList& argv, const QString& workingDirectory, QString& error);
+    };
+
+} // namespace quicksearch::models
@@ -0,0 +1,365 @@
+#include "pathindex.hpp"
+#include "directorywatcher.hpp"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QWriteLocker>
+#include <algorithm>
+
+namespace quicksearch::models {
+
+    void PathIndex::PostingList::append(quint32 id) {
+        quint32 delta = count == 0 ? id : id - last;
+        while (delta >= 0x80) {
+            data.append(static_cast<char>((delta & 0x7f) | 0x80));
+            delta >>= 7;
+        }
+        data.append(static_cast<char>(delta));
+        last = id;
+        ++count;
+    }
+
+    QVector<quint32> PathIndex::PostingList::decode() const {
+        QVector<quint32> ids;
+        ids.reserve(count);
+
+        quint32 value = 0;
+        quint32 delta = 0;
+        int shift = 0;
+        for (const char byte : data) {
+            const auto bits = static_cast<quint8>(byte);
+            delta |= static_cast<quint32>(bits & 0x7f) << shift;
+            if (bits & 0x80) {
+                shift += 7;
+                continue;
+            }
+
+            value = ids.isEmpty() ? delta : value + delta;
+            ids.append(value);
+            delta = 0;
+            shift = 0;
+        }
+
+        return ids;
+    }
+
+    PathIndex::PathIndex(const Options& options)
+    : m_options(options)
+    , m_root(QDir::cleanPath(options.root))
+    , m_built(false)
+    , m_deadCount(0)
+    , m_watched(false)
+    , m_fullyWatched(true) {}
+
+    PathIndex::~PathIndex() {
+        if (m_watched) {
+            DirectoryWatcher::unwatch(this);
+        }
+    }
+
+    std::shared_ptr<PathIndex> PathIndex::shared(const Options& options) {
+        static QMutex mutex;
+        static QList<std::weak_ptr<PathIndex>> indexes;
+
+        QMutexLocker locker(&mutex);
+        indexes.removeIf([](const std::weak_ptr<PathIndex>& index) {
+            return index.expired();
+        });
+        for (const auto& weak : std::as_const(indexes)) {
+            if (auto index = weak.lock(); index && index->options() == options) {
+                return index;
+            }
+        }
+
+        auto index = std::make_shared<PathIndex>(options);
+        index->m_watched = true;
+        indexes.append(index);
+        return index;
+    }
+
+    bool PathIndex::ensureBuilt(const std::function<bool()>& isCanceled) {
+        QWriteLocker locker(&m_lock);
+        if (m_built) {
+            return true;
+        }
+
+        // The walk below sees the current state, so earlier changes are moot
+        {
+            QMutexLocker changesLocker(&m_changesMutex);
+            m_changes.clear();
+        }
+
+        clear();
+        if (!walk(m_root, 0, isCanceled)) {
+            clear();
+            return false;
+        }
+
+        m_built = true;
+        return true;
+    }
+
+    void PathIndex::queueChange(const Change& change) {
+        QMutexLocker locker(&m_changesMutex);
+        m_changes.append(change);
+    }
+
+    void PathIndex::applyQueuedChanges() {
+        QList<Change> changes;
+        {
+            QMutexLocker locker(&m_changesMutex);
+            changes.swap(m_changes);
+        }
+
+        if (changes.isEmpty()) {
+            return;
+        }
+
+        QWriteLocker locker(&m_lock);
+        if (!m_built) {
+            return; // The initial walk will see these changes anyway
+        }
+
+        // The watcher dropped events; only a new walk is sure to be right
+        const bool overflowed = std::any_of(changes.cbegin(), changes.cend(), [](const Change& change) {
+            return change.kind == Change::Kind::Overflow;
+        });
+        if (overflowed) {
+            clear();
+            walk(m_root, 0, {});
+            return;
+        }
+
+        for (const auto& change : std::as_const(changes)) {
+            applyChange(change);
+        }
+
+        // Removed entries linger in the posting lists until compaction
+        if (m_deadCount > 1024 && m_deadCount * 2 > size()) {
+            compact();
+        }
+    }
+
+    std::optional<quint32> PathIndex::find(const QString& path) const {
+        const auto it = m_ids.constFind(path);
+        if (it == m_ids.constEnd()) {
+            return std::nullopt;
+        }
+        return it.value();
+    }
+
+    std::optional<QVector<quint32>> PathIndex::candidates(const QString& query) const {
+        const QVector<quint64> keys = trigrams(query);
+        if (keys.isEmpty()) {
+            return std::nullopt;
+        }
+
+        QVector<const PostingList*> lists;
+        lists.reserve(keys.size());
+        for (const quint64 key : keys) {
+            const auto it = m_postings.constFind(key);
+            if (it == m_postings.constEnd()) {
+                return QVector<quint32>(); // Some trigram appears in no name at all
+            }
+            lists.append(&it.value());
+        }
+
+        // Intersect starting from the rarest trigram to keep intermediate lists small
+        std::sort(lists.begin(), lists.end(), [](const PostingList* a, const PostingList* b) {
+            return a->count < b->count;
+        });
+
+        QVector<quint32> result = lists.first()->decode();
+        for (qsizetype i = 1; i < lists.size() && !result.isEmpty(); ++i) {
+            const QVector<quint32> other = lists.at(i)->decode();
+            QVector<quint32> intersection;
+            intersection.reserve(qMin(result.size(), other.size()));
+            std::set_intersection(result.cbegin(), result.cend(), other.cbegin(), other.cend(),
+                                  std::back_inserter(intersection));
+            result.swap(intersection);
+        }
+
+        result.removeIf([this](quint32 id) {
+            return !m_entries.at(id).alive;
+        });
+        return result;
+    }
+
+    bool PathIndex::walk(const QString& dir, int depth, const std::function<bool()>& isCanceled) {
+        QDir::Filters filters = QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot;
+        if (m_options.showHidden) {
+            filters |= QDir::Hidden;
+        }
+
+        // Explicit stack so deep trees don't recurse; stops at maxDepth instead
+        // of walking everything below it and discarding the results
+        QList<QPair<QString, int>> pending;
+        pending.append(qMakePair(dir, depth));
+
+        while (!pending.isEmpty()) {
+            const auto [current, currentDepth] = pending.takeLast();
+
+            if (m_watched && !DirectoryWatcher::instance()->watch(this, current)) {
+                m_fullyWatched = false;
+            }
+
+            QDirIterator iter(current, filters);
+            while (iter.hasNext()) {
+                if (isCanceled && isCanceled()) {
+                    return false;
+                }
+
+                iter.next();
+                const QFileInfo info = iter.fileInfo();
+                const bool isDir = info.isDir();
+                const quint32 id = addEntry(current, info.fileName(), currentDepth, isDir);
+
+                // Like QDirIterator::Subdirectories, don't follow symlinked dirs
+                if (isDir && !info.isSymLink() && m_options.recursive && shouldDescend(currentDepth)) {
+                    pending.append(qMakePair(m_entries.at(id).path, currentDepth + 1));
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool PathIndex::shouldDescend(int depth) const {
+        return m_options.maxDepth < 0 || depth < m_options.maxDepth;
+    }
+
+    quint32 PathIndex::addEntry(const QString& dir, const QString& name, int depth, bool isDir) {
+        const auto id = static_cast<quint32>(m_entries.size());
+        const QString path = dir.endsWith('/') ? dir + name : dir + '/' + name;
+
+        m_entries.append(Entry { path, dir, name, depth, isDir, true, FileType::fromName(name, isDir) });
+        m_ids.insert(path, id);
+        m_children[dir].append(id);
+
+        for (const quint64 key : trigrams(name)) {
+            m_postings[key].append(id);
+        }
+
+        return id;
+    }
+
+    void PathIndex::removeEntry(quint32 id) {
+        Entry& entry = m_entries[id];
+        if (!entry.alive) {
+            return;
+        }
+
+        if (entry.isDir) {
+            const QList<quint32> children = m_children.take(entry.path);
+            for (const quint32 child : children) {
+                removeEntry(child);
+            }
+        }
+
+        const auto siblings = m_children.find(entry.dir);
+        if (siblings != m_children.end()) {
+            siblings->removeOne(id);
+        }
+
+        entry.alive = false;
+        m_ids.remove(entry.path);
+        ++m_deadCount;
+    }
+
+    int PathIndex::childDepth(const QString& dir) const {
+        if (dir == m_root) {
+            return 0;
+        }
+
+        const auto it = m_ids.constFind(dir);
+        if (it == m_ids.constEnd()) {
+            return -1; // Outside the index, or already gone with its parent
+        }
+
+        const Entry& parent = m_entries.at(it.value());
+        if (!parent.isDir || !m_options.recursive || !shouldDescend(parent.depth)) {
+            return -1;
+        }
+        return parent.depth + 1;
+    }
+
+    void PathIndex::applyChange(const Change& change) {
+        const QString path = change.dir.endsWith('/') ? change.dir + change.name : change.dir + '/' + change.name;
+
+        if (change.kind == Change::Kind::Removed) {
+            const auto it = m_ids.constFind(path);
+            if (it != m_ids.constEnd()) {
+                removeEntry(it.value());
+            }
+            return;
+        }
+
+        // A new directory's walk may have found this already
+        if (m_ids.contains(path) || (!m_options.showHidden && change.name.startsWith('.'))) {
+            return;
+        }
+
+        const int depth = childDepth(change.dir);
+        if (depth < 0) {
+            return;
+        }
+
+        // Gone again before this got here, or its type is needed the way the walk sees it
+        const QFileInfo info(path);
+        if (!info.exists()) {
+            return;
+        }
+
+        const quint32 id = addEntry(change.dir, change.name, depth, info.isDir());
+        if (info.isDir() && !info.isSymLink() && m_options.recursive && shouldDescend(depth)) {
+            // Created or moved in with contents: index them, which watches it too
+            walk(m_entries.at(id).path, depth + 1, {});
+        }
+    }
+
+    void PathIndex::compact() {
+        QVector<Entry> live;
+        live.reserve(m_entries.size() - m_deadCount);
+        for (auto& entry : m_entries) {
+            if (entry.alive) {
+                live.append(std::move(entry));
+            }
+        }
+
+        clear();
+        for (const auto& entry : std::as_const(live)) {
+            addEntry(entry.dir, entry.name, entry.depth, entry.isDir);
+        }
+    }
+
+    void PathIndex::clear() {
+        m_entries.clear();
+        m_ids.clear();
+        m_children.clear();
+        m_postings.clear();
+        m_deadCount = 0;
+    }
+
+    QVector<quint64> PathIndex::trigrams(const QString& text) {
+        QVector<quint64> keys;
+
+        const QString folded = text.toLower();
+        if (folded.length() < 3) {
+            return keys;
+        }
+
+        keys.reserve(folded.length() - 2);
+        for (qsizetype i = 0; i + 2 < folded.length(); ++i) {
+            keys.append((static_cast<quint64>(folded.at(i).unicode()) << 32) |
+                        (static_cast<quint64>(folded.at(i + 1).unicode()) << 16) |
+                        static_cast<quint64>(folded.at(i + 2).unicode()));
+        }
+
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        return keys;
+    }
+
+} // namespace quicksearch::models
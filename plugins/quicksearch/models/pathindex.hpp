@@ -0,0 +1,149 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+
+#include "filetype.hpp"
+
+namespace quicksearch::models {
+
+    // In-memory index of a directory tree.
+    //
+    // Built once on a worker thread and then kept up to date from the changes
+    // the DirectoryWatcher reports (shared indexes only), so queries never
+    // have to walk the filesystem. Alongside the entries it keeps a trigram
+    // inverted index over the lowercased file names: for queries of three or
+    // more characters only names containing every query trigram are scored.
+    // Each entry carries its FileType as far as the name decides it.
+    //
+    // Thread safety: ensureBuilt/applyQueuedChanges take the write lock
+    // internally. Readers must hold lock() for reading while they use entry(),
+    // find(), children() or candidates().
+    class PathIndex {
+    public:
+        struct Options {
+            QString root;
+            bool recursive = false;
+            bool showHidden = false;
+            int maxDepth = -1;
+
+            bool operator==(const Options& other) const {
+                return root == other.root && recursive == other.recursive && showHidden == other.showHidden &&
+                       maxDepth == other.maxDepth;
+            }
+            bool operator!=(const Options& other) const { return !(*this == other); }
+        };
+
+        struct Entry {
+            QString path;
+            QString dir;  // parent directory
+            QString name;
+            int depth;   // 0 for direct children of the root
+            bool isDir;
+            bool alive;  // false once removed, until the next compaction
+            FileType type; // from the name; unresolved if only the contents can tell
+        };
+
+        // An entry the watcher saw appear or disappear, or lost track (Overflow)
+        struct Change {
+            enum class Kind : quint8 {
+                Added,
+                Removed,
+                Overflow,
+            };
+
+            Kind kind;
+            QString dir;
+            QString name;
+        };
+
+        explicit PathIndex(const Options& options);
+        ~PathIndex();
+
+        // One index per set of options, shared by every model that uses them
+        // while any of them is alive, so lenses over the same tree walk it once.
+        // Shared indexes watch the directories they contain.
+        static std::shared_ptr<PathIndex> shared(const Options& options);
+
+        [[nodiscard]] const Options& options() const { return m_options; }
+        [[nodiscard]] QReadWriteLock* lock() const { return &m_lock; }
+
+        // Walks the tree if that hasn't happened yet. Returns false if the walk
+        // was cancelled, in which case the next call starts over.
+        bool ensureBuilt(const std::function<bool()>& isCanceled);
+
+        // Queues a change from the watcher. Cheap, safe from any thread.
+        void queueChange(const Change& change);
+
+        // Applies the queued changes
+        void applyQueuedChanges();
+
+        // False once a directory couldn't be watched, usually for lack of inotify watches
+        [[nodiscard]] bool isFullyWatched() const { return m_fullyWatched; }
+
+        // Number of entry slots, including removed ones (check Entry::alive)
+        [[nodiscard]] quint32 size() const { return static_cast<quint32>(m_entries.size()); }
+        [[nodiscard]] const Entry& entry(quint32 id) const { return m_entries.at(id); }
+
+        // The live entry at path, and the live entries directly in dir
+        [[nodiscard]] std::optional<quint32> find(const QString& path) const;
+        [[nodiscard]] QList<quint32> children(const QString& dir) const { return m_children.value(dir); }
+
+        // Ascending IDs of live entries whose name contains every trigram of the
+        // query (case-insensitive). std::nullopt if the query is too short for
+        // trigram lookup and the caller has to scan.
+        [[nodiscard]] std::optional<QVector<quint32>> candidates(const QString& query) const;
+
+    private:
+        // Sorted IDs, stored as LEB128-encoded deltas. IDs are handed out in
+        // increasing order, so appending never needs to decode the list.
+        struct PostingList {
+            QByteArray data;
+            quint32 last = 0;
+            quint32 count = 0;
+
+            void append(quint32 id);
+            [[nodiscard]] QVector<quint32> decode() const;
+        };
+
+        Options m_options;
+        QString m_root; // cleaned root path, no trailing slash
+        bool m_built;
+
+        QVector<Entry> m_entries;
+        QHash<QString, quint32> m_ids;               // path -> id of live entries
+        QHash<QString, QList<quint32>> m_children;   // dir path -> ids of live children
+        QHash<quint64, PostingList> m_postings;      // trigram -> ids
+        quint32 m_deadCount;
+
+        mutable QReadWriteLock m_lock;
+
+        QMutex m_changesMutex;
+        QList<Change> m_changes;
+
+        bool m_watched;
+        std::atomic_bool m_fullyWatched;
+
+        bool walk(const QString& dir, int depth, const std::function<bool()>& isCanceled);
+        [[nodiscard]] bool shouldDescend(int depth) const;
+        quint32 addEntry(const QString& dir, const QString& name, int depth, bool isDir);
+        void removeEntry(quint32 id);
+        void applyChange(const Change& change);
+        // Depth of dir's entries, or -1 if the index doesn't cover them
+        [[nodiscard]] int childDepth(const QString& dir) const;
+        void compact();
+        void clear();
+
+        static QVector<quint64> trigrams(const QString& text);
+    };
+
+} // namespace quicksearch::models
@@ -0,0 +1,394 @@
+#include "thumbnailcache.hpp"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJSEngine>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QVector>
+#include <algorithm>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        constexpr quint32 IndexMagic = 0x49544e55; // "UNTI"
+        constexpr quint32 IndexVersion = 1;
+
+        // Evicting down to a bit below the budget leaves room for a while
+        constexpr double EvictTo = 0.9;
+
+        // Records of thumbnails other applications wrote (a few MiB of index);
+        // their files are never ours to delete, only the records are dropped
+        constexpr qsizetype MaxUnownedEntries = 32768;
+
+        constexpr qint64 SaveIntervalMs = 10 * 1000;
+
+    } // namespace
+
+    ThumbnailCache* ThumbnailCache::instance() {
+        static ThumbnailCache* cache = new ThumbnailCache(QCoreApplication::instance());
+        return cache;
+    }
+
+    ThumbnailCache* ThumbnailCache::create(QQmlEngine*, QJSEngine*) {
+        auto* cache = instance();
+        QJSEngine::setObjectOwnership(cache, QJSEngine::CppOwnership);
+        return cache;
+    }
+
+    ThumbnailCache::ThumbnailCache(QObject* parent)
+    : QObject(parent)
+    , m_budget(DefaultDiskBudget)
+    , m_ownedBytes(0)
+    , m_unownedCount(0)
+    , m_loaded(false)
+    , m_dirty(false)
+    , m_images(DefaultMemoryBudget) {
+        // Access times gathered since the last periodic save
+        connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, this, [this]() {
+            QMutexLocker locker(&m_mutex);
+            if (m_dirty) {
+                save();
+            }
+        });
+    }
+
+    ThumbnailCache::Status ThumbnailCache::find(Thumbnailer::Kind kind, const QString& path, qint64 mtime, int size,
+                                                QString* file) {
+        QMutexLocker locker(&m_mutex);
+        ensureLoaded();
+
+        const auto it = m_entries.find(key(kind, path));
+        if (it == m_entries.end() || it->mtime != mtime) {
+            return Status::Missing;
+        }
+
+        if (it->flags & FailedMarker) {
+            return Status::Failed;
+        }
+        if (it->size < size) {
+            return Status::Missing;
+        }
+
+        it->lastAccess = QDateTime::currentSecsSinceEpoch();
+        m_dirty = true;
+        if (file) {
+            *file = it->file;
+        }
+
+        if (saveDue()) {
+            save();
+        }
+        return Status::Found;
+    }
+
+    void ThumbnailCache::insert(Thumbnailer::Kind kind, const QString& path, qint64 mtime, int size,
+                                const QString& file, bool owned, bool failed) {
+        // The one stat per thumbnail, when it is written or first found
+        const qint64 bytes = QFileInfo(file).size();
+
+        QMutexLocker locker(&m_mutex);
+        ensureLoaded();
+
+        const quint64 entryKey = key(kind, path);
+        const auto existing = m_entries.constFind(entryKey);
+        if (existing != m_entries.cend() && !(existing->flags & Owned)) {
+            --m_unownedCount;
+        }
+        Entry& entry = m_entries[entryKey];
+
+        if (!entry.file.isEmpty()) {
+            dropImages(entry.file);
+        }
+
+        // A thumbnail we wrote for an older version of the file is garbage now
+        if ((entry.flags & Owned) && !entry.file.isEmpty()) {
+            m_ownedBytes -= entry.bytes;
+            if (entry.file != file) {
+                QFile::remove(entry.file);
+            }
+        }
+
+        entry.mtime = mtime;
+        entry.bytes = bytes;
+        entry.lastAccess = QDateTime::currentSecsSinceEpoch();
+        entry.size = quint16(qBound(0, size, 0xffff));
+        entry.flags = quint8((owned ? Owned : 0) | (failed ? FailedMarker : 0));
+        entry.file = file;
+
+        if (owned) {
+            m_ownedBytes += bytes;
+        } else {
+            ++m_unownedCount;
+        }
+        m_dirty = true;
+
+        if (m_ownedBytes > m_budget || m_unownedCount > MaxUnownedEntries) {
+            evict();
+        }
+        if (saveDue()) {
+            save();
+        }
+    }
+
+    void ThumbnailCache::remove(Thumbnailer::Kind kind, const QString& path) {
+        QMutexLocker locker(&m_mutex);
+        ensureLoaded();
+
+        const auto it = m_entries.find(key(kind, path));
+        if (it == m_entries.end()) {
+            return;
+        }
+
+        if (it->flags & Owned) {
+            m_ownedBytes -= it->bytes;
+        } else {
+            --m_unownedCount;
+        }
+        dropImages(it->file);
+        m_entries.erase(it);
+        m_dirty = true;
+    }
+
+    QImage ThumbnailCache::image(const QString& file, const QSize& size) {
+        QMutexLocker locker(&m_imagesMutex);
+        const DecodedImages* images = m_images.object(file);
+        if (!images) {
+            return QImage();
+        }
+        for (const auto& [decodedSize, image] : images->sizes) {
+            if (decodedSize == size) {
+                return image;
+            }
+        }
+        return QImage();
+    }
+
+    void ThumbnailCache::insertImage(const QString& file, const QSize& size, const QImage& image) {
+        if (image.isNull()) {
+            return;
+        }
+
+        // The formats the scene graph uploads without converting
+        const QImage::Format format =
+            image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+        const QImage converted = image.convertToFormat(format);
+
+        // Re-inserted with the cost of all its sizes, which also makes it most recent
+        QMutexLocker locker(&m_imagesMutex);
+        DecodedImages* images = m_images.take(file);
+        if (!images) {
+            images = new DecodedImages;
+        }
+        images->sizes.removeIf([&size, images](const QPair<QSize, QImage>& decoded) {
+            if (decoded.first != size) {
+                return false;
+            }
+            images->bytes -= decoded.second.sizeInBytes();
+            return true;
+        });
+        images->sizes.append(qMakePair(size, converted));
+        images->bytes += converted.sizeInBytes();
+        m_images.insert(file, images, images->bytes);
+    }
+
+    qint64 ThumbnailCache::diskBudget() const {
+        QMutexLocker locker(&m_mutex);
+        return m_budget;
+    }
+
+    void ThumbnailCache::setDiskBudget(qint64 bytes) {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (m_budget == bytes) {
+                return;
+            }
+            m_budget = qMax<qint64>(0, bytes);
+        }
+        emit diskBudgetChanged();
+
+        // Shrinking may delete files; not on the GUI thread
+        QThreadPool::globalInstance()->start([this]() {
+            QMutexLocker locker(&m_mutex);
+            ensureLoaded();
+            if (m_ownedBytes > m_budget || m_unownedCount > MaxUnownedEntries) {
+                evict();
+                save();
+            }
+        });
+    }
+
+    qint64 ThumbnailCache::memoryBudget() const {
+        QMutexLocker locker(&m_imagesMutex);
+        return m_images.maxCost();
+    }
+
+    void ThumbnailCache::setMemoryBudget(qint64 bytes) {
+        {
+            QMutexLocker locker(&m_imagesMutex);
+            bytes = qMax<qint64>(0, bytes);
+            if (m_images.maxCost() == bytes) {
+                return;
+            }
+            m_images.setMaxCost(bytes); // Trims right away
+        }
+        emit memoryBudgetChanged();
+    }
+
+    void ThumbnailCache::ensureLoaded() {
+        // Called with the mutex held
+        if (m_loaded) {
+            return;
+        }
+        m_loaded = true;
+        m_sinceSave.start();
+
+        QFile file(indexPath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            return;
+        }
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_6_0);
+
+        quint32 magic = 0;
+        quint32 version = 0;
+        quint32 count = 0;
+        in >> magic >> version >> count;
+        if (magic != IndexMagic || version != IndexVersion) {
+            return;
+        }
+
+        QHash<quint64, Entry> entries;
+        entries.reserve(count);
+        qint64 ownedBytes = 0;
+        qsizetype unownedCount = 0;
+        for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+            quint64 entryKey = 0;
+            Entry entry;
+            in >> entryKey >> entry.mtime >> entry.bytes >> entry.lastAccess >> entry.size >> entry.flags >> entry.file;
+            if (entry.flags & Owned) {
+                ownedBytes += entry.bytes;
+            } else {
+                ++unownedCount;
+            }
+            entries.insert(entryKey, entry);
+        }
+
+        if (in.status() != QDataStream::Ok) {
+            return;
+        }
+
+        m_entries = std::move(entries);
+        m_ownedBytes = ownedBytes;
+        m_unownedCount = unownedCount;
+
+        // Indexes from before unowned records were capped may be over the limit
+        if (m_unownedCount > MaxUnownedEntries) {
+            evict();
+        }
+    }
+
+    void ThumbnailCache::evict() {
+        // Called with the mutex held. One LRU over every record: our thumbnails
+        // go with their files until the disk budget fits, other applications'
+        // only lose their records until few enough remain.
+        struct Victim {
+            qint64 lastAccess;
+            quint64 key;
+        };
+
+        QVector<Victim> victims;
+        victims.reserve(m_entries.size());
+        for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+            victims.append(Victim { it->lastAccess, it.key() });
+        }
+        std::sort(victims.begin(), victims.end(), [](const Victim& a, const Victim& b) {
+            return a.lastAccess < b.lastAccess;
+        });
+
+        const qint64 bytesTarget = qint64(double(m_budget) * EvictTo);
+        const auto unownedTarget = qsizetype(double(MaxUnownedEntries) * EvictTo);
+        for (const Victim& victim : std::as_const(victims)) {
+            const bool overBytes = m_ownedBytes > bytesTarget;
+            const bool overCount = m_unownedCount > unownedTarget;
+            if (!overBytes && !overCount) {
+                break;
+            }
+
+            const auto it = m_entries.find(victim.key);
+            if (it->flags & Owned) {
+                if (!overBytes) {
+                    continue;
+                }
+                QFile::remove(it->file);
+                m_ownedBytes -= it->bytes;
+            } else {
+                if (!overCount) {
+                    continue;
+                }
+                --m_unownedCount;
+            }
+            dropImages(it->file);
+            m_entries.erase(it);
+        }
+
+        m_dirty = true;
+    }
+
+    void ThumbnailCache::save() {
+        // Called with the mutex held
+        m_sinceSave.start();
+
+        const QString path = indexPath();
+        QDir().mkpath(QFileInfo(path).absolutePath());
+
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            return;
+        }
+
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_6_0);
+
+        out << IndexMagic << IndexVersion << quint32(m_entries.size());
+        for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+            out << it.key() << it->mtime << it->bytes << it->lastAccess << it->size << it->flags << it->file;
+        }
+
+        if (file.commit()) {
+            m_dirty = false;
+        }
+    }
+
+    bool ThumbnailCache::saveDue() const {
+        return m_dirty && (!m_sinceSave.isValid() || m_sinceSave.elapsed() > SaveIntervalMs);
+    }
+
+    void ThumbnailCache::dropImages(const QString& file) {
+        QMutexLocker locker(&m_imagesMutex);
+        m_images.remove(file);
+    }
+
+    quint64 ThumbnailCache::key(Thumbnailer::Kind kind, const QString& path) {
+        // FNV-1a: stable across runs, unlike the seeded qHash()
+        quint64 hash = 0xcbf29ce484222325ULL;
+        hash ^= quint64(kind) + 1;
+        hash *= 0x100000001b3ULL;
+        for (const QChar c : path) {
+            hash ^= c.unicode();
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    QString ThumbnailCache::indexPath() {
+        return QDir::homePath() + "/.cache/unite/thumbnail-index.bin";
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QMutex>
+#include <QObject>
+#include <QPair>
+#include <QSize>
+#include <QString>
+#include <qqmlintegration.h>
+
+#include "thumbnailer.hpp"
+
+class QQmlEngine;
+class QJSEngine;
+
+namespace quicksearch::models {
+
+    // Index of the thumbnails we know about, with a disk budget.
+    //
+    // One small record per source file (kind, source mtime, thumbnail file,
+    // bytes, last access) kept in memory and persisted to
+    // ~/.cache/unite/thumbnail-index.bin, so "is there a thumbnail for this?"
+    // is answered without touching the thumbnail directories. A record whose
+    // source mtime doesn't match is stale and its thumbnail is replaced.
+    //
+    // Thumbnails we wrote count against diskBudget and the least recently
+    // used are deleted when it is exceeded. Thumbnails found in the shared
+    // cache that other applications wrote are indexed too, but never deleted;
+    // past a fixed number of them the least recently used records are dropped.
+    //
+    // Decoded thumbnails are kept too, keyed by thumbnail file with the sizes
+    // it was decoded at, in an LRU of memoryBudget bytes shared by every
+    // lens, so reopening the Dash or switching lenses shows them without
+    // reading or decoding a file.
+    //
+    // instance() must first be called from the GUI thread; everything else
+    // may be called from any thread.
+    class ThumbnailCache : public QObject {
+        Q_OBJECT
+        QML_ELEMENT
+        QML_SINGLETON
+
+        // Bytes of thumbnails we keep on disk before evicting
+        Q_PROPERTY(qint64 diskBudget READ diskBudget WRITE setDiskBudget NOTIFY diskBudgetChanged)
+        // Bytes of decoded thumbnails kept in memory
+        Q_PROPERTY(qint64 memoryBudget READ memoryBudget WRITE setMemoryBudget NOTIFY memoryBudgetChanged)
+
+    public:
+        static constexpr qint64 DefaultDiskBudget = 256LL * 1024 * 1024;
+        static constexpr qint64 DefaultMemoryBudget = 64LL * 1024 * 1024;
+
+        static ThumbnailCache* instance();
+        static ThumbnailCache* create(QQmlEngine* qmlEngine, QJSEngine* jsEngine);
+
+        enum class Status {
+            Missing, // not indexed, or indexed for another mtime
+            Found,   // file holds a thumbnail
+            Failed   // thumbnailing this version of the source failed before
+        };
+
+        // Looks up a thumbnail of at least size pixels for the source as of mtime
+        Status find(Thumbnailer::Kind kind, const QString& path, qint64 mtime, int size, QString* file);
+
+        // Records the thumbnail (or failure marker) file for the source as of
+        // mtime. owned is false for thumbnails written by other applications.
+        void insert(Thumbnailer::Kind kind, const QString& path, qint64 mtime, int size, const QString& file,
+                    bool owned, bool failed = false);
+
+        // Drops the record for the source, e.g. when its thumbnail vanished
+        void remove(Thumbnailer::Kind kind, const QString& path);
+
+        // The thumbnail file as decoded at size, if it is still in memory
+        QImage image(const QString& file, const QSize& size);
+        // Keeps a decoded thumbnail file, converted for texture upload
+        void insertImage(const QString& file, const QSize& size, const QImage& image);
+
+        [[nodiscard]] qint64 diskBudget() const;
+        void setDiskBudget(qint64 bytes);
+
+        [[nodiscard]] qint64 memoryBudget() const;
+        void setMemoryBudget(qint64 bytes);
+
+    signals:
+        void diskBudgetChanged();
+        void memoryBudgetChanged();
+
+    private:
+        explicit ThumbnailCache(QObject* parent = nullptr);
+
+        enum Flag : quint8 {
+            Owned = 1 << 0,
+            FailedMarker = 1 << 1
+        };
+
+        struct Entry {
+            qint64 mtime = 0;      // of the source, seconds
+            qint64 bytes = 0;      // of the thumbnail file
+            qint64 lastAccess = 0; // seconds since the epoch
+            quint16 size = 0;      // thumbnail flavor, pixels
+            quint8 flags = 0;
+            QString file;
+        };
+
+        mutable QMutex m_mutex;
+        QHash<quint64, Entry> m_entries;
+        qint64 m_budget;
+        qint64 m_ownedBytes;
+        qsizetype m_unownedCount;
+        bool m_loaded;
+        bool m_dirty;
+        QElapsedTimer m_sinceSave;
+
+        // A thumbnail file decoded at one or more sizes (rarely more than two)
+        struct DecodedImages {
+            QList<QPair<QSize, QImage>> sizes;
+            qsizetype bytes = 0;
+        };
+
+        mutable QMutex m_imagesMutex;
+        QCache<QString, DecodedImages> m_images; // by thumbnail file, cost in bytes
+
+        void ensureLoaded();
+        void evict();
+        void save();
+
+        // Accumulated access times are written at most this often
+        bool saveDue() const;
+
+        // Forgets the decoded copies of a thumbnail file being replaced or deleted
+        void dropImages(const QString& file);
+
+        static quint64 key(Thumbnailer::Kind kind, const QString& path);
+        static QString indexPath();
+    };
+
+} // namespace quicksearch::models
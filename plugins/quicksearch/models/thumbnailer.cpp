@@ -0,0 +1,465 @@
+#include "thumbnailer.hpp"
+#include "albumcovers.hpp"
+#include "thumbnailcache.hpp"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QMimeDatabase>
+#include <QSaveFile>
+#include <QTransform>
+#include <QUrl>
+#include <QtEndian>
+#include <cstring>
+#include <iterator>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        struct Flavor {
+            const char* name;
+            int size;
+        };
+
+        // Smallest first, as listed by the Thumbnail Managing Standard
+        constexpr Flavor Flavors[] = {
+            { "normal", 128 },
+            { "large", 256 },
+            { "x-large", 512 },
+            { "xx-large", 1024 },
+        };
+
+        // Smallest flavor holding size pixels, or the largest there is
+        const Flavor& flavorFor(int size) {
+            for (const Flavor& flavor : Flavors) {
+                if (size <= flavor.size) {
+                    return flavor;
+                }
+            }
+            return Flavors[std::size(Flavors) - 1];
+        }
+
+        // Failure markers live under a directory named after the generator
+        const QString FailDirName = QStringLiteral("fail/unite-1.0");
+
+        const QString UriKey = QStringLiteral("Thumb::URI");
+        const QString MTimeKey = QStringLiteral("Thumb::MTime");
+
+        // Older thumbnails were PNG for images and JPEG otherwise
+        constexpr const char* PrivateSuffixes[] = { ".webp", ".jpg", ".png" };
+
+        constexpr int LossyQuality = 85;
+
+        // WebP when the image formats plugin is installed, JPEG otherwise
+        const char* lossyFormat() {
+            static const bool hasWebp = QImageWriter::supportedImageFormats().contains("webp");
+            return hasWebp ? "webp" : "jpg";
+        }
+
+        quint16 readU16(const uchar* p, bool bigEndian) {
+            return bigEndian ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
+        }
+
+        quint32 readU32(const uchar* p, bool bigEndian) {
+            return bigEndian ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
+        }
+
+        // Applies an EXIF orientation (1-8) to an image stored unrotated
+        QImage oriented(const QImage& image, int orientation) {
+            QTransform rotation;
+            switch (orientation) {
+            case 3:
+                rotation.rotate(180);
+                break;
+            case 5:
+            case 8:
+                rotation.rotate(270);
+                break;
+            case 6:
+            case 7:
+                rotation.rotate(90);
+                break;
+            default:
+                break;
+            }
+
+            // 2, 4, 5 and 7 are mirrored first
+            QImage result = image;
+            if (orientation == 2 || orientation == 5 || orientation == 7) {
+                result = result.mirrored(true, false);
+            } else if (orientation == 4) {
+                result = result.mirrored(false, true);
+            }
+            return rotation.isIdentity() ? result : result.transformed(rotation);
+        }
+
+        QString cacheHome() {
+            QString cache = qEnvironmentVariable("XDG_CACHE_HOME");
+            if (cache.isEmpty()) {
+                cache = QDir::homePath() + "/.cache";
+            }
+            return cache + "/thumbnails";
+        }
+
+        // Where the thumbnail of one file at one size goes, per the spec
+        struct Target {
+            QFileInfo info;
+            QString path; // absolute
+            qint64 mtime; // seconds
+            const Flavor* flavor;
+            QString root;
+            QString uri;
+            QString name; // <md5 of uri>.png
+        };
+
+        Target targetFor(const QString& path, int size) {
+            Target target;
+            target.info = QFileInfo(path);
+            target.path = target.info.absoluteFilePath();
+            target.mtime = target.info.lastModified().toSecsSinceEpoch();
+            target.flavor = &flavorFor(size > 0 ? size : Thumbnailer::DefaultSize);
+            target.root = cacheHome();
+            target.uri = QUrl::fromLocalFile(target.path).toString(QUrl::FullyEncoded);
+            target.name =
+                QString::fromLatin1(QCryptographicHash::hash(target.uri.toUtf8(), QCryptographicHash::Md5).toHex()) +
+                ".png";
+            return target;
+        }
+
+        QImage scaledToFit(const QImage& image, int size) {
+            if (image.width() > size || image.height() > size) {
+                return image.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            }
+            return image;
+        }
+
+    } // namespace
+
+    bool Thumbnailer::lookup(Kind kind, const QString& path, int size, QString* file) {
+        const Target target = targetFor(path, size);
+        file->clear();
+        if (!target.info.isFile()) {
+            return true;
+        }
+
+        // Never thumbnail thumbnails
+        if (target.path.startsWith(target.root + '/')) {
+            if (kind == Kind::Image) {
+                *file = target.path;
+            }
+            return true;
+        }
+
+        // Images that already fit are displayed as they are
+        if (kind == Kind::Image) {
+            const QSize imageSize = QImageReader(target.path).size();
+            if (imageSize.isValid() && imageSize.width() <= target.flavor->size &&
+                imageSize.height() <= target.flavor->size) {
+                *file = target.path;
+                return true;
+            }
+        }
+
+        // Known thumbnails are answered from the index, without a stat
+        ThumbnailCache* cache = ThumbnailCache::instance();
+        switch (cache->find(kind, target.path, target.mtime, target.flavor->size, file)) {
+        case ThumbnailCache::Status::Found:
+        case ThumbnailCache::Status::Failed:
+            return true;
+        case ThumbnailCache::Status::Missing:
+            break;
+        }
+
+        // Any flavor at least as large as wanted will do, whoever made it
+        for (const Flavor& candidate : Flavors) {
+            const QString thumbnail = target.root + '/' + candidate.name + '/' + target.name;
+            if (candidate.size >= target.flavor->size && isValid(thumbnail, target.uri, target.mtime)) {
+                cache->insert(kind, target.path, target.mtime, candidate.size, thumbnail, false);
+                *file = thumbnail;
+                return true;
+            }
+        }
+
+        const QString failFile = target.root + '/' + FailDirName + '/' + target.name;
+        if (isValid(failFile, target.uri, target.mtime)) {
+            cache->insert(kind, target.path, target.mtime, target.flavor->size, failFile, true, true);
+            return true;
+        }
+
+        // Our own cache from before we used the shared one. Video and music
+        // thumbnails there are keyed by path only, so one older than the
+        // file is stale.
+        const QString privateBase = privateCachePath(kind, target.info);
+        for (const char* suffix : PrivateSuffixes) {
+            const QString privateFile = privateBase + suffix;
+            const QFileInfo privateInfo(privateFile);
+            if (!privateInfo.exists() || privateInfo.lastModified() < target.info.lastModified()) {
+                continue;
+            }
+            cache->insert(kind, target.path, target.mtime, DefaultSize, privateFile, true);
+            *file = privateFile;
+            return true;
+        }
+
+        return false;
+    }
+
+    QString Thumbnailer::store(Kind kind, const QString& path, int size, const QImage& thumbnail) {
+        const Target target = targetFor(path, size);
+        ThumbnailCache* cache = ThumbnailCache::instance();
+
+        if (thumbnail.isNull()) {
+            const QString failFile = target.root + '/' + FailDirName + '/' + target.name;
+            QImage marker(1, 1, QImage::Format_ARGB32);
+            marker.fill(Qt::transparent);
+            if (save(marker, failFile, target.uri, target.info)) {
+                cache->insert(kind, target.path, target.mtime, target.flavor->size, failFile, true, true);
+            }
+            return QString();
+        }
+
+        const QImage scaled = scaledToFit(thumbnail, target.flavor->size);
+
+        const QString file = target.root + '/' + target.flavor->name + '/' + target.name;
+        if (save(scaled, file, target.uri, target.info)) {
+            cache->insert(kind, target.path, target.mtime, target.flavor->size, file, true);
+            return file;
+        }
+
+        // Shared cache not writable: keep it to ourselves instead. The spec
+        // mandates PNG above, but here opaque thumbnails can be lossy.
+        const QString privateBase = privateCachePath(kind, target.info);
+        QDir().mkpath(QFileInfo(privateBase).absolutePath());
+        const char* format = scaled.hasAlphaChannel() ? "png" : lossyFormat();
+        const QString privateFile = privateBase + '.' + format;
+        if (scaled.save(privateFile, format, scaled.hasAlphaChannel() ? -1 : LossyQuality)) {
+            cache->insert(kind, target.path, target.mtime, target.flavor->size, privateFile, true);
+            return privateFile;
+        }
+
+        return QString();
+    }
+
+    QString Thumbnailer::generate(Kind kind, const QString& path, int size, const std::function<bool()>& isCanceled) {
+        if (isCanceled && isCanceled()) {
+            return QString();
+        }
+
+        QString file;
+        if (lookup(kind, path, size, &file)) {
+            return file;
+        }
+
+        const int flavorSize = flavorFor(size > 0 ? size : DefaultSize).size;
+        QImage thumbnail;
+        switch (kind) {
+        case Kind::Image:
+            thumbnail = renderImage(path, flavorSize);
+            break;
+        case Kind::Music: {
+            // Tracks point at their album's shared cover instead of a copy each
+            const QString cover = AlbumCovers::thumbnail(path, flavorSize, isCanceled);
+            if (!cover.isEmpty()) {
+                const Target target = targetFor(path, size);
+                ThumbnailCache::instance()->insert(kind, target.path, target.mtime, flavorSize, cover, false);
+                return cover;
+            }
+            break;
+        }
+        case Kind::Video:
+            return QString(); // Rendered by VideoThumbnailer, then store()d
+        }
+
+        // A canceled attempt says nothing about the file
+        if (isCanceled && isCanceled()) {
+            return QString();
+        }
+
+        return store(kind, path, size, thumbnail);
+    }
+
+    bool Thumbnailer::isValid(const QString& thumbnail, const QString& uri, qint64 mtime) {
+        if (!QFileInfo::exists(thumbnail)) {
+            return false;
+        }
+
+        // Only the header and text chunks are read, not the pixels
+        QImageReader reader(thumbnail, "png");
+        return reader.text(UriKey) == uri && reader.text(MTimeKey) == QString::number(mtime);
+    }
+
+    bool Thumbnailer::save(QImage image, const QString& file, const QString& uri, const QFileInfo& info) {
+        const QString dir = QFileInfo(file).absolutePath();
+        if (!QDir().mkpath(dir)) {
+            return false;
+        }
+        QFile::setPermissions(dir, QFile::ReadOwner | QFile::WriteOwner | QFile::ExeOwner);
+
+        image.setText(UriKey, uri);
+        image.setText(MTimeKey, QString::number(info.lastModified().toSecsSinceEpoch()));
+        image.setText(QStringLiteral("Thumb::Size"), QString::number(info.size()));
+        image.setText(QStringLiteral("Thumb::Mime"), QMimeDatabase().mimeTypeForFile(info).name());
+        image.setText(QStringLiteral("Software"), QStringLiteral("Unite"));
+
+        // Written to a temporary file and renamed, so readers never see half a PNG
+        QSaveFile out(file);
+        if (!out.open(QIODevice::WriteOnly) || !image.save(&out, "PNG") || !out.commit()) {
+            return false;
+        }
+
+        QFile::setPermissions(file, QFile::ReadOwner | QFile::WriteOwner);
+        return true;
+    }
+
+    QString Thumbnailer::privateCachePath(Kind kind, const QFileInfo& info) {
+        const QString path = info.absoluteFilePath();
+
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(path.toUtf8());
+
+        // Images were keyed by modification time too
+        if (kind == Kind::Image) {
+            hash.addData(QString::number(info.lastModified().toMSecsSinceEpoch()).toUtf8());
+        }
+        const QString hashStr = QString::fromLatin1(hash.result().toHex());
+
+        switch (kind) {
+        case Kind::Image:
+            return QDir::homePath() + "/.cache/unite/image-thumbnails/" + hashStr;
+        case Kind::Video:
+            return QDir::homePath() + "/.cache/unite/video-thumbnails/" + hashStr;
+        case Kind::Music:
+            return QDir::homePath() + "/.cache/unite/music-thumbnails/" + hashStr;
+        }
+
+        return QString();
+    }
+
+    QImage Thumbnailer::renderImage(const QString& path, int size) {
+        QImageReader reader(path);
+        reader.setAutoTransform(true);
+
+        const QSize imageSize = reader.size();
+        if (imageSize.isValid()) {
+            // Cameras embed a small preview; for small flavors it is all we need
+            if (reader.format() == "jpeg") {
+                const QImage embedded = exifThumbnail(path, imageSize, size);
+                if (!embedded.isNull()) {
+                    return scaledToFit(embedded, size);
+                }
+            }
+
+            // Have the decoder scale: JPEG then decodes at 1/2, 1/4 or 1/8 in
+            // the DCT domain instead of inflating every pixel first
+            if (imageSize.width() > size || imageSize.height() > size) {
+                reader.setScaledSize(imageSize.scaled(size, size, Qt::KeepAspectRatio));
+            }
+        }
+
+        const QImage image = reader.read();
+        if (image.isNull()) {
+            return QImage();
+        }
+        return scaledToFit(image, size);
+    }
+
+    QImage Thumbnailer::exifThumbnail(const QString& path, const QSize& imageSize, int size) {
+        // The Exif segment comes first and is limited to 64 KiB
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QImage();
+        }
+        const QByteArray head = file.read(128 * 1024);
+        const auto* data = reinterpret_cast<const uchar*>(head.constData());
+        const qsizetype length = head.size();
+
+        if (length < 4 || data[0] != 0xff || data[1] != 0xd8) {
+            return QImage();
+        }
+
+        // Find APP1 "Exif\0\0" among the markers before the image data
+        qsizetype tiff = -1;
+        qsizetype tiffLength = 0;
+        for (qsizetype pos = 2; pos + 4 <= length && data[pos] == 0xff;) {
+            const uchar marker = data[pos + 1];
+            const qsizetype segment = qFromBigEndian<quint16>(data + pos + 2);
+            if (marker == 0xda || segment < 2) {
+                break;
+            }
+            if (marker == 0xe1 && segment >= 8 && pos + 10 <= length &&
+                std::memcmp(data + pos + 4, "Exif\0\0", 6) == 0) {
+                tiff = pos + 10;
+                tiffLength = qMin<qsizetype>(segment - 8, length - tiff);
+                break;
+            }
+            pos += 2 + segment;
+        }
+
+        if (tiff < 0 || tiffLength < 8) {
+            return QImage();
+        }
+
+        const uchar* base = data + tiff;
+        const bool bigEndian = base[0] == 'M' && base[1] == 'M';
+        if (!bigEndian && !(base[0] == 'I' && base[1] == 'I')) {
+            return QImage();
+        }
+
+        // Walks one IFD, returning the offset of the next
+        int orientation = 1;
+        quint32 thumbOffset = 0;
+        quint32 thumbLength = 0;
+        const auto readIfd = [&](quint32 offset) -> quint32 {
+            if (offset == 0 || quint64(offset) + 2 > quint64(tiffLength)) {
+                return 0;
+            }
+            const quint16 count = readU16(base + offset, bigEndian);
+            if (quint64(offset) + 2 + quint64(count) * 12 + 4 > quint64(tiffLength)) {
+                return 0;
+            }
+            for (quint16 i = 0; i < count; ++i) {
+                const uchar* entry = base + offset + 2 + i * 12;
+                const quint16 tag = readU16(entry, bigEndian);
+                const quint16 type = readU16(entry + 2, bigEndian);
+                const quint32 value = type == 3 ? readU16(entry + 8, bigEndian) : readU32(entry + 8, bigEndian);
+                if (tag == 0x0112) {
+                    orientation = int(value);
+                } else if (tag == 0x0201) {
+                    thumbOffset = value;
+                } else if (tag == 0x0202) {
+                    thumbLength = value;
+                }
+            }
+            return readU32(base + offset + 2 + quint32(count) * 12, bigEndian);
+        };
+
+        // IFD0 has the orientation, IFD1 the thumbnail
+        readIfd(readIfd(readU32(base + 4, bigEndian)));
+
+        if (thumbOffset == 0 || thumbLength == 0 || quint64(thumbOffset) + thumbLength > quint64(tiffLength)) {
+            return QImage();
+        }
+
+        QImage thumbnail;
+        if (!thumbnail.loadFromData(base + thumbOffset, int(thumbLength), "JPEG")) {
+            return QImage();
+        }
+
+        // Too small, or letterboxed to a different shape than the photo
+        if (qMax(thumbnail.width(), thumbnail.height()) < size) {
+            return QImage();
+        }
+        const double aspect = double(imageSize.width()) / imageSize.height();
+        const double thumbAspect = double(thumbnail.width()) / thumbnail.height();
+        if (qAbs(thumbAspect - aspect) > aspect * 0.02) {
+            return QImage();
+        }
+
+        return oriented(thumbnail, orientation);
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QFileInfo>
+#include <QImage>
+#include <QSize>
+#include <QString>
+#include <functional>
+
+namespace quicksearch::models {
+
+    // Generates and caches thumbnails for images, videos and music files.
+    //
+    // Thumbnails are shared with other applications through the freedesktop
+    // Thumbnail Managing Standard: ~/.cache/thumbnails/{normal,large,x-large,
+    // xx-large}/<md5 of the file URI>.png, validated by the Thumb::URI and
+    // Thumb::MTime text chunks, with failures remembered under fail/unite-1.0/.
+    // Our older ~/.cache/unite/*-thumbnails directories are still read, and
+    // written to (as WebP or JPEG unless there is alpha) only when the shared
+    // cache isn't writable.
+    //
+    // Photos are never decoded at full size: the Exif preview is used when it
+    // is big enough, and otherwise the decoder scales while decoding.
+    // Music files point at their album's cover, thumbnailed once by
+    // AlbumCovers, rather than getting a thumbnail each.
+    //
+    // Everything here blocks (decoding, hashing, writing files), so it is
+    // only called from the thumbnail provider's worker pool, never from a
+    // property getter on the GUI thread. Video frames are grabbed by
+    // VideoThumbnailer's process pool and handed to store().
+    class Thumbnailer {
+    public:
+        enum class Kind {
+            Image,
+            Video,
+            Music
+        };
+
+        // Size used when the caller doesn't ask for one (the x-large flavor)
+        static constexpr int DefaultSize = 512;
+
+        // Path of a thumbnail of at least size pixels (or the file itself if
+        // it is a small enough image), generating it if needed. Empty if none
+        // could be made or isCanceled() returned true.
+        // Videos are only looked up here; see VideoThumbnailer.
+        static QString generate(Kind kind, const QString& path, int size, const std::function<bool()>& isCanceled);
+
+        // Answers from the caches only: true with file set to the thumbnail,
+        // or empty if the file can't be thumbnailed; false if one has to be made
+        static bool lookup(Kind kind, const QString& path, int size, QString* file);
+
+        // Scales and stores a thumbnail made elsewhere, returning its file.
+        // A null thumbnail records that the file can't be thumbnailed.
+        static QString store(Kind kind, const QString& path, int size, const QImage& thumbnail);
+
+    private:
+        static bool isValid(const QString& thumbnail, const QString& uri, qint64 mtime);
+        static bool save(QImage image, const QString& file, const QString& uri, const QFileInfo& info);
+        static QString privateCachePath(Kind kind, const QFileInfo& info);
+
+        static QImage renderImage(const QString& path, int size);
+        // The JPEG preview in a photo's Exif data, upright, if it is at least size pixels
+        static QImage exifThumbnail(const QString& path, const QSize& imageSize, int size);
+    };
+
+} // namespace quicksearch::models
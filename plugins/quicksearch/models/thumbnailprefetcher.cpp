@@ -0,0 +1,111 @@
+#include "thumbnailprefetcher.hpp"
+#include "thumbnailprovider.hpp"
+#include "videothumbnailer.hpp"
+
+#include <QCoreApplication>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+
+namespace quicksearch::models {
+
+    ThumbnailPrefetcher::ThumbnailPrefetcher(QObject* parent)
+    : QObject(parent)
+    , m_size(Thumbnailer::DefaultSize) {}
+
+    ThumbnailPrefetcher::~ThumbnailPrefetcher() {
+        for (Pending& pending : m_pending) {
+            cancel(pending);
+        }
+    }
+
+    void ThumbnailPrefetcher::setWindow(const QList<Item>& items, int size) {
+        size = size > 0 ? size : Thumbnailer::DefaultSize;
+
+        // A different size is a different thumbnail; start over
+        if (size != m_size) {
+            for (Pending& pending : m_pending) {
+                cancel(pending);
+            }
+            m_pending.clear();
+            m_size = size;
+        }
+
+        QSet<QString> window;
+        window.reserve(items.size());
+        for (const Item& item : items) {
+            window.insert(item.path);
+        }
+
+        for (auto it = m_pending.begin(); it != m_pending.end();) {
+            if (window.contains(it.key())) {
+                ++it;
+                continue;
+            }
+            cancel(*it);
+            it = m_pending.erase(it);
+        }
+
+        for (const Item& item : items) {
+            if (!m_pending.contains(item.path)) {
+                Pending& pending = m_pending[item.path];
+                pending.canceled = std::make_shared<std::atomic_bool>(false);
+                start(item.path, item.kind);
+            }
+        }
+    }
+
+    void ThumbnailPrefetcher::start(const QString& path, Thumbnailer::Kind kind, std::optional<QImage> frame) {
+        const Pending& pending = m_pending[path];
+        auto* job = new ThumbnailJob(kind, path, QSize(m_size, m_size), pending.canceled, std::move(frame));
+
+        // The file may have left the window and come back by the time this arrives
+        const auto canceled = pending.canceled;
+        connect(job, &ThumbnailJob::missing, this, [this, path, canceled]() {
+            const auto it = m_pending.find(path);
+            if (it != m_pending.end() && it->canceled == canceled) {
+                onMissing(path);
+            }
+        }, Qt::QueuedConnection);
+
+        pool()->start(job);
+    }
+
+    void ThumbnailPrefetcher::cancel(Pending& pending) {
+        pending.canceled->store(true);
+        if (pending.videoRequest != 0) {
+            VideoThumbnailer::instance()->cancel(pending.videoRequest);
+            pending.videoRequest = 0;
+        }
+    }
+
+    void ThumbnailPrefetcher::onMissing(const QString& path) {
+        Pending& pending = m_pending[path];
+        const auto canceled = pending.canceled;
+        pending.videoRequest = VideoThumbnailer::instance()->request(
+            path, m_size, VideoThumbnailer::Priority::Low, this,
+            [this, path, canceled](const QImage& frame, bool wasCanceled) {
+                const auto it = m_pending.find(path);
+                if (it == m_pending.end() || it->canceled != canceled) {
+                    return;
+                }
+                it->videoRequest = 0;
+                if (wasCanceled || canceled->load()) {
+                    return;
+                }
+                start(path, Thumbnailer::Kind::Video, frame);
+            });
+    }
+
+    QThreadPool* ThumbnailPrefetcher::pool() {
+        // One worker: prefetching should never compete with what's on screen
+        static QThreadPool* pool = []() {
+            auto* threadPool = new QThreadPool(QCoreApplication::instance());
+            threadPool->setMaxThreadCount(1);
+            threadPool->setThreadPriority(QThread::LowPriority);
+            return threadPool;
+        }();
+        return pool;
+    }
+
+} // namespace quicksearch::models
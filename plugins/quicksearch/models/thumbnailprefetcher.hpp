@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <atomic>
+#include <memory>
+#include <optional>
+
+#include "thumbnailer.hpp"
+
+class QThreadPool;
+
+namespace quicksearch::models {
+
+    // Makes thumbnails ahead of the view, for FileSystemModel::prefetch().
+    //
+    // Holds a window of files; thumbnails are made for those that don't have
+    // one yet on a single low-priority worker shared by all models, and
+    // videos are queued on VideoThumbnailer at low priority, so on-screen
+    // requests always go first. Work for files that leave the window is
+    // canceled: jobs that haven't started are skipped and video requests
+    // are dropped. Lives on the GUI thread.
+    class ThumbnailPrefetcher : public QObject {
+        Q_OBJECT
+
+    public:
+        struct Item {
+            Thumbnailer::Kind kind;
+            QString path;
+        };
+
+        explicit ThumbnailPrefetcher(QObject* parent = nullptr);
+        ~ThumbnailPrefetcher() override;
+
+        // Replaces the window: starts what is new, cancels what left it
+        void setWindow(const QList<Item>& items, int size);
+
+    private:
+        // Kept until the file leaves the window, finished or not, so moving
+        // the window doesn't redo it
+        struct Pending {
+            std::shared_ptr<std::atomic_bool> canceled;
+            quint64 videoRequest = 0; // pending VideoThumbnailer request, 0 if none
+        };
+
+        QHash<QString, Pending> m_pending; // by path
+        int m_size;
+
+        void start(const QString& path, Thumbnailer::Kind kind, std::optional<QImage> frame = std::nullopt);
+        void cancel(Pending& pending);
+        void onMissing(const QString& path);
+
+        static QThreadPool* pool();
+    };
+
+} // namespace quicksearch::models
@@ -0,0 +1,204 @@
+#include "thumbnailprovider.hpp"
+#include "thumbnailcache.hpp"
+#include "videothumbnailer.hpp"
+
+#include <QImageReader>
+#include <QThread>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        const char* kindName(Thumbnailer::Kind kind) {
+            switch (kind) {
+            case Thumbnailer::Kind::Image:
+                return "image";
+            case Thumbnailer::Kind::Video:
+                return "video";
+            case Thumbnailer::Kind::Music:
+                return "music";
+            }
+            return "";
+        }
+
+        // The path is base64url-encoded so slashes, '#' and '?' survive the URL
+        constexpr auto PathEncoding = QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals;
+
+        // Decodes straight to requestedSize (keeping the aspect ratio) when given
+        QImage loadScaled(const QString& file, const QSize& requestedSize) {
+            QImageReader reader(file);
+            reader.setAutoTransform(true);
+
+            const QSize size = reader.size();
+            if (size.isValid() && (requestedSize.width() > 0 || requestedSize.height() > 0)) {
+                QSize bounds = requestedSize;
+                if (bounds.width() <= 0) {
+                    bounds.setWidth(size.width());
+                }
+                if (bounds.height() <= 0) {
+                    bounds.setHeight(size.height());
+                }
+                if (size.width() > bounds.width() || size.height() > bounds.height()) {
+                    reader.setScaledSize(size.scaled(bounds, Qt::KeepAspectRatio));
+                }
+            }
+
+            return reader.read();
+        }
+
+    } // namespace
+
+    ThumbnailProvider::ThumbnailProvider() {
+        // Decoding and music art extraction; video processes are capped separately
+        m_pool.setMaxThreadCount(qBound(2, QThread::idealThreadCount() / 2, 4));
+    }
+
+    QString ThumbnailProvider::source(Thumbnailer::Kind kind, const QString& path) {
+        return QStringLiteral("image://%1/%2/%3")
+            .arg(QLatin1String(Id), QLatin1String(kindName(kind)),
+                 QString::fromLatin1(path.toUtf8().toBase64(PathEncoding)));
+    }
+
+    QQuickImageResponse* ThumbnailProvider::requestImageResponse(const QString& id, const QSize& requestedSize) {
+        const QString kindPart = id.section('/', 0, 0);
+        const QString path = QString::fromUtf8(QByteArray::fromBase64(id.section('/', 1).toLatin1(), PathEncoding));
+
+        Thumbnailer::Kind kind = Thumbnailer::Kind::Image;
+        if (kindPart == QLatin1String("video")) {
+            kind = Thumbnailer::Kind::Video;
+        } else if (kindPart == QLatin1String("music")) {
+            kind = Thumbnailer::Kind::Music;
+        }
+
+        return new ThumbnailResponse(kind, path, requestedSize, &m_pool);
+    }
+
+    ThumbnailJob::ThumbnailJob(Thumbnailer::Kind kind, const QString& path, const QSize& requestedSize,
+                               std::shared_ptr<std::atomic_bool> canceled, std::optional<QImage> frame)
+    : m_kind(kind)
+    , m_path(path)
+    , m_requestedSize(requestedSize)
+    , m_canceled(std::move(canceled))
+    , m_frame(std::move(frame)) {
+        setAutoDelete(true);
+    }
+
+    void ThumbnailJob::run() {
+        const auto isCanceled = [this]() {
+            return m_canceled->load();
+        };
+
+        const int size = qMax(m_requestedSize.width(), m_requestedSize.height());
+
+        QImage image;
+        for (int attempt = 0; attempt < 2 && !isCanceled() && !m_path.isEmpty(); ++attempt) {
+            QString file;
+            if (m_frame) {
+                file = Thumbnailer::store(m_kind, m_path, size, *m_frame);
+            } else if (m_kind == Thumbnailer::Kind::Video) {
+                if (!Thumbnailer::lookup(m_kind, m_path, size, &file)) {
+                    emit missing();
+                    return;
+                }
+            } else {
+                file = Thumbnailer::generate(m_kind, m_path, size, isCanceled);
+            }
+
+            if (file.isEmpty() || isCanceled()) {
+                break;
+            }
+
+            // Decoded already, for this lens or another. Files shown as they are
+            // may change under the same name, so only thumbnails are kept.
+            ThumbnailCache* cache = ThumbnailCache::instance();
+            const bool isThumbnail = file != m_path;
+            if (isThumbnail) {
+                image = cache->image(file, m_requestedSize);
+                if (!image.isNull()) {
+                    break;
+                }
+            }
+
+            image = loadScaled(file, m_requestedSize);
+            if (!image.isNull() && isThumbnail) {
+                cache->insertImage(file, m_requestedSize, image);
+            }
+
+            // The index said it exists; if it was deleted behind our back, make it again
+            if (!image.isNull() || !isThumbnail) {
+                break;
+            }
+            cache->remove(m_kind, m_path);
+        }
+
+        // Also sent when canceled: the engine waits for finished() to clean up
+        emit done(image);
+    }
+
+    ThumbnailResponse::ThumbnailResponse(Thumbnailer::Kind kind, const QString& path, const QSize& requestedSize,
+                                         QThreadPool* pool)
+    : m_kind(kind)
+    , m_path(path)
+    , m_requestedSize(requestedSize)
+    , m_pool(pool)
+    , m_canceled(std::make_shared<std::atomic_bool>(false))
+    , m_videoRequest(0) {
+        startJob(std::nullopt);
+    }
+
+    QQuickTextureFactory* ThumbnailResponse::textureFactory() const {
+        return QQuickTextureFactory::textureFactoryForImage(m_image);
+    }
+
+    QString ThumbnailResponse::errorString() const {
+        return m_error;
+    }
+
+    void ThumbnailResponse::cancel() {
+        m_canceled->store(true);
+
+        // Answered with canceled, which finishes this response
+        if (m_videoRequest != 0) {
+            VideoThumbnailer::instance()->cancel(m_videoRequest);
+        }
+    }
+
+    void ThumbnailResponse::startJob(std::optional<QImage> frame) {
+        auto* job = new ThumbnailJob(m_kind, m_path, m_requestedSize, m_canceled, std::move(frame));
+        connect(job, &ThumbnailJob::done, this, &ThumbnailResponse::onDone, Qt::QueuedConnection);
+        connect(job, &ThumbnailJob::missing, this, &ThumbnailResponse::onMissing, Qt::QueuedConnection);
+        m_pool->start(job);
+    }
+
+    void ThumbnailResponse::onMissing() {
+        if (m_canceled->load()) {
+            onDone(QImage());
+            return;
+        }
+
+        const int size = qMax(m_requestedSize.width(), m_requestedSize.height());
+        m_videoRequest = VideoThumbnailer::instance()->request(
+            m_path, size > 0 ? size : Thumbnailer::DefaultSize, VideoThumbnailer::Priority::High, this,
+            [this](const QImage& frame, bool canceled) {
+                onFrame(frame, canceled);
+            });
+    }
+
+    void ThumbnailResponse::onFrame(const QImage& frame, bool canceled) {
+        m_videoRequest = 0;
+        if (canceled || m_canceled->load()) {
+            onDone(QImage());
+            return;
+        }
+        startJob(frame);
+    }
+
+    void ThumbnailResponse::onDone(const QImage& image) {
+        m_image = image;
+        if (m_image.isNull()) {
+            m_error = m_canceled->load() ? QStringLiteral("Canceled") : QStringLiteral("No thumbnail available");
+        }
+        emit finished();
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <QImage>
+#include <QObject>
+#include <QQuickAsyncImageProvider>
+#include <QRunnable>
+#include <QSize>
+#include <QString>
+#include <QThreadPool>
+#include <atomic>
+#include <memory>
+#include <optional>
+
+#include "thumbnailer.hpp"
+
+namespace quicksearch::models {
+
+    // Serves image://quicksearch-thumb/<kind>/<path> URLs.
+    //
+    // Thumbnails are generated on a small pool of its own so a screen full of
+    // media can't starve indexing or searching on the global pool; video
+    // frames come from VideoThumbnailer's process pool. Each Image shows its
+    // placeholder until the response finishes; decoded thumbnails come from
+    // ThumbnailCache's memory LRU when they can. When the delegate is destroyed
+    // or its source changes, the engine cancels the response, and work that
+    // hasn't started is skipped.
+    class ThumbnailProvider : public QQuickAsyncImageProvider {
+    public:
+        static constexpr const char* Id = "quicksearch-thumb";
+
+        ThumbnailProvider();
+
+        // URL of the thumbnail for path, for binding to Image.source
+        static QString source(Thumbnailer::Kind kind, const QString& path);
+
+        QQuickImageResponse* requestImageResponse(const QString& id, const QSize& requestedSize) override;
+
+    private:
+        QThreadPool m_pool;
+    };
+
+    // Runs on the provider's pool and hands the decoded image back to the
+    // response's thread. Deleted by the pool once run.
+    //
+    // Videos take two jobs: the first only looks in the caches and reports
+    // missing() if a frame has to be grabbed; once VideoThumbnailer has one,
+    // the second stores it (a null frame records the failure).
+    class ThumbnailJob : public QObject, public QRunnable {
+        Q_OBJECT
+
+    public:
+        ThumbnailJob(Thumbnailer::Kind kind, const QString& path, const QSize& requestedSize,
+                     std::shared_ptr<std::atomic_bool> canceled, std::optional<QImage> frame = std::nullopt);
+
+        void run() override;
+
+    signals:
+        void done(const QImage& image);
+        void missing();
+
+    private:
+        const Thumbnailer::Kind m_kind;
+        const QString m_path;
+        const QSize m_requestedSize;
+        const std::shared_ptr<std::atomic_bool> m_canceled;
+        const std::optional<QImage> m_frame;
+    };
+
+    class ThumbnailResponse : public QQuickImageResponse {
+        Q_OBJECT
+
+    public:
+        ThumbnailResponse(Thumbnailer::Kind kind, const QString& path, const QSize& requestedSize, QThreadPool* pool);
+
+        [[nodiscard]] QQuickTextureFactory* textureFactory() const override;
+        [[nodiscard]] QString errorString() const override;
+
+        void cancel() override;
+
+    private:
+        const Thumbnailer::Kind m_kind;
+        const QString m_path;
+        const QSize m_requestedSize;
+        QThreadPool* const m_pool;
+
+        QImage m_image;
+        QString m_error;
+        const std::shared_ptr<std::atomic_bool> m_canceled;
+        quint64 m_videoRequest; // pending VideoThumbnailer request, 0 if none
+
+        void startJob(std::optional<QImage> frame);
+        void onMissing();
+        void onFrame(const QImage& frame, bool canceled);
+        void onDone(const QImage& image);
+    };
+
+} // namespace quicksearch::models
@@ -0,0 +1,333 @@
+#include "videothumbnailer.hpp"
+
+#include <QCoreApplication>
+#include <QJSEngine>
+#include <QStringList>
+#include <QTimer>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+
+namespace quicksearch::models {
+
+    namespace {
+
+        // Candidates are keyframes at least this far apart, from the start
+        // of the video up to SampleSeconds in; only those are decoded
+        constexpr int CandidateFrames = 8;
+        constexpr int SampleIntervalSeconds = 10;
+        constexpr int SampleSeconds = CandidateFrames * SampleIntervalSeconds;
+
+        // Frames this dark or this bright on average are fades and title cards
+        constexpr double DarkLuma = 24.0;
+        constexpr double BrightLuma = 232.0;
+
+        // Takes one binary PPM (P6, maxval 255) off the front of buffer.
+        // Returns false if it isn't complete yet.
+        bool takePpm(QByteArray& buffer, QImage* frame) {
+            const qsizetype length = buffer.size();
+            const char* data = buffer.constData();
+
+            if (length >= 2 && (data[0] != 'P' || data[1] != '6')) {
+                buffer.clear(); // Not PPM: nothing more will make sense
+                return false;
+            }
+
+            // "P6" <ws> width <ws> height <ws> maxval <one ws> pixels
+            qsizetype pos = 2;
+            int fields[3] = { 0, 0, 0 };
+            for (int& field : fields) {
+                while (pos < length && std::isspace(uchar(data[pos]))) {
+                    ++pos;
+                }
+                const qsizetype start = pos;
+                while (pos < length && std::isdigit(uchar(data[pos]))) {
+                    field = field * 10 + (data[pos] - '0');
+                    ++pos;
+                }
+                if (pos == start || pos >= length) {
+                    return false;
+                }
+            }
+            ++pos;
+
+            const int width = fields[0];
+            const int height = fields[1];
+            if (width <= 0 || height <= 0 || fields[2] != 255) {
+                buffer.clear();
+                return false;
+            }
+
+            const qsizetype bytesPerLine = qsizetype(width) * 3;
+            if (length - pos < bytesPerLine * height) {
+                return false;
+            }
+
+            QImage image(width, height, QImage::Format_RGB888);
+            for (int y = 0; y < height; ++y) {
+                std::memcpy(image.scanLine(y), data + pos + y * bytesPerLine, bytesPerLine);
+            }
+
+            buffer.remove(0, pos + bytesPerLine * height);
+            *frame = image;
+            return true;
+        }
+
+        // How much a frame shows: the standard deviation of its luma, heavily
+        // discounted for frames that are almost black or almost white.
+        // Straight loops over scanLine() that the compiler can vectorize.
+        double informativeness(const QImage& frame) {
+            quint64 sum = 0;
+            quint64 sumSquares = 0;
+            quint64 count = 0;
+
+            const int width = frame.width();
+            for (int y = 0; y < frame.height(); y += 2) {
+                const uchar* pixel = frame.constScanLine(y);
+
+                quint32 rowSum = 0;
+                quint32 rowSquares = 0;
+                for (int x = 0; x < width; ++x) {
+                    const quint32 luma = (77u * pixel[3 * x] + 150u * pixel[3 * x + 1] + 29u * pixel[3 * x + 2]) >> 8;
+                    rowSum += luma;
+                    rowSquares += luma * luma;
+                }
+
+                sum += rowSum;
+                sumSquares += rowSquares;
+                count += quint64(width);
+            }
+
+            if (count == 0) {
+                return 0.0;
+            }
+
+            const double mean = double(sum) / double(count);
+            const double variance = qMax(0.0, double(sumSquares) / double(count) - mean * mean);
+            const double penalty = (mean < DarkLuma || mean > BrightLuma) ? 0.1 : 1.0;
+            return std::sqrt(variance) * penalty;
+        }
+
+    } // namespace
+
+    VideoThumbnailer* VideoThumbnailer::instance() {
+        static VideoThumbnailer* thumbnailer = new VideoThumbnailer(QCoreApplication::instance());
+        return thumbnailer;
+    }
+
+    VideoThumbnailer* VideoThumbnailer::create(QQmlEngine*, QJSEngine*) {
+        auto* thumbnailer = instance();
+        QJSEngine::setObjectOwnership(thumbnailer, QJSEngine::CppOwnership);
+        return thumbnailer;
+    }
+
+    VideoThumbnailer::VideoThumbnailer(QObject* parent)
+    : QObject(parent)
+    , m_program("ffmpeg")
+    , m_maxProcesses(2)
+    , m_timeout(10000)
+    , m_running(0)
+    , m_sequence(0)
+    , m_nextId(0) {}
+
+    quint64 VideoThumbnailer::request(const QString& path, int size, Priority priority, QObject* context,
+                                      Callback callback) {
+        const quint64 id = ++m_nextId;
+        QMetaObject::invokeMethod(this, [this, id, path, size, priority, context, callback]() {
+            enqueue(id, path, size, priority, context, callback);
+        }, Qt::QueuedConnection);
+        return id;
+    }
+
+    void VideoThumbnailer::cancel(quint64 id) {
+        QMetaObject::invokeMethod(this, [this, id]() {
+            dequeue(id);
+        }, Qt::QueuedConnection);
+    }
+
+    QString VideoThumbnailer::program() const {
+        return m_program;
+    }
+
+    void VideoThumbnailer::setProgram(const QString& program) {
+        if (m_program == program) {
+            return;
+        }
+        m_program = program;
+        emit programChanged();
+    }
+
+    int VideoThumbnailer::maxProcesses() const {
+        return m_maxProcesses;
+    }
+
+    void VideoThumbnailer::setMaxProcesses(int maxProcesses) {
+        maxProcesses = qMax(1, maxProcesses);
+        if (m_maxProcesses == maxProcesses) {
+            return;
+        }
+        m_maxProcesses = maxProcesses;
+        emit maxProcessesChanged();
+        schedule();
+    }
+
+    int VideoThumbnailer::timeout() const {
+        return m_timeout;
+    }
+
+    void VideoThumbnailer::setTimeout(int timeout) {
+        if (m_timeout == timeout) {
+            return;
+        }
+        m_timeout = timeout;
+        emit timeoutChanged();
+    }
+
+    void VideoThumbnailer::enqueue(quint64 id, const QString& path, int size, Priority priority, QObject* context,
+                                   Callback callback) {
+        Job*& job = m_jobs[path];
+        if (!job) {
+            job = new Job;
+            job->path = path;
+        }
+
+        // A running job keeps its size; a larger frame is scaled down anyway
+        if (!job->started) {
+            job->size = qMax(job->size, size);
+        }
+        job->priority = qMax(job->priority, priority);
+        job->sequence = ++m_sequence;
+        job->waiters.append(Waiter { id, context, std::move(callback) });
+
+        schedule();
+    }
+
+    void VideoThumbnailer::dequeue(quint64 id) {
+        for (Job* job : std::as_const(m_jobs)) {
+            for (qsizetype i = 0; i < job->waiters.size(); ++i) {
+                if (job->waiters.at(i).id != id) {
+                    continue;
+                }
+
+                reply(job->waiters.takeAt(i), QImage(), true);
+
+                // Nobody wants this video any more: drop it, killing its process
+                if (job->waiters.isEmpty()) {
+                    finish(job, QImage());
+                }
+                return;
+            }
+        }
+    }
+
+    void VideoThumbnailer::schedule() {
+        while (m_running < m_maxProcesses) {
+            Job* next = nullptr;
+            for (Job* job : std::as_const(m_jobs)) {
+                if (job->started) {
+                    continue;
+                }
+                if (!next || job->priority > next->priority ||
+                    (job->priority == next->priority && job->sequence > next->sequence)) {
+                    next = job;
+                }
+            }
+
+            if (!next) {
+                return;
+            }
+
+            next->started = true;
+            ++m_running;
+            start(next);
+        }
+    }
+
+    void VideoThumbnailer::start(Job* job) {
+        // One process per video: keyframes only, spread over the first
+        // minutes, scaled by ffmpeg and streamed back as PPM
+        const QStringList arguments = {
+            "-hide_banner", "-loglevel", "error", "-nostdin",
+            "-skip_frame", "nokey",
+            "-t", QString::number(SampleSeconds),
+            "-i", job->path,
+            "-an", "-sn",
+            "-vf", QString("select='isnan(prev_selected_t)+gte(t-prev_selected_t,%1)',"
+                           "scale=%2:%2:force_original_aspect_ratio=decrease")
+                       .arg(SampleIntervalSeconds)
+                       .arg(job->size),
+            "-vsync", "0",
+            "-frames:v", QString::number(CandidateFrames),
+            "-f", "image2pipe", "-vcodec", "ppm", "-",
+        };
+
+        auto* process = new QProcess(this);
+        job->process = process;
+
+        // Nobody reads its chatter; a full pipe would stall it
+        process->setStandardErrorFile(QProcess::nullDevice());
+
+        // Frames are scored as they arrive; only the best one is kept
+        connect(process, &QProcess::readyReadStandardOutput, this, [job, process]() {
+            job->buffer += process->readAllStandardOutput();
+
+            QImage frame;
+            while (takePpm(job->buffer, &frame)) {
+                const double score = informativeness(frame);
+                if (score > job->bestScore) {
+                    job->bestScore = score;
+                    job->best = frame;
+                }
+            }
+        });
+
+        // Whatever arrived before an exit, crash or timeout still counts
+        connect(process, &QProcess::finished, this, [this, job]() {
+            finish(job, job->best);
+        });
+
+        connect(process, &QProcess::errorOccurred, this, [this, job](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                finish(job, QImage());
+            }
+        });
+
+        QTimer::singleShot(m_timeout, process, [process]() {
+            process->kill();
+        });
+
+        process->start(m_program, arguments);
+    }
+
+    void VideoThumbnailer::finish(Job* job, const QImage& frame) {
+        for (const Waiter& waiter : std::as_const(job->waiters)) {
+            reply(waiter, frame, false);
+        }
+
+        if (job->process) {
+            job->process->disconnect(this);
+            job->process->kill();
+            job->process->deleteLater();
+        }
+        if (job->started) {
+            --m_running;
+        }
+
+        m_jobs.remove(job->path);
+        delete job;
+
+        schedule();
+    }
+
+    void VideoThumbnailer::reply(const Waiter& waiter, const QImage& frame, bool canceled) {
+        // Contexts on the GUI thread may be gone by now; responses on the
+        // image loader thread outlive their reply
+        if (!waiter.context) {
+            return;
+        }
+        QMetaObject::invokeMethod(waiter.context, [callback = waiter.callback, frame, canceled]() {
+            callback(frame, canceled);
+        }, Qt::QueuedConnection);
+    }
+
+} // namespace quicksearch::models
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QProcess>
+#include <QString>
+#include <atomic>
+#include <functional>
+#include <qqmlintegration.h>
+
+class QQmlEngine;
+class QJSEngine;
+
+namespace quicksearch::models {
+
+    // Grabs video frames with an external decoder, a few processes at a time.
+    //
+    // Processes run asynchronously on the GUI thread's event loop, so nothing
+    // waits on them. A video costs one process: ffmpeg decodes only keyframes,
+    // picks up to eight at least ten seconds apart from the first minutes,
+    // scales them and writes them to stdout as binary PPM. Each frame is
+    // scored as it arrives (luma spread, with near-black and near-white
+    // frames discounted) and the best one wins. The process is killed after
+    // `timeout` ms, keeping the frames it sent so far.
+    //
+    // Requests for a video that is already queued or running share its
+    // result. Queued videos start highest priority first and, within a
+    // priority, most recently requested first, which favors what was just
+    // scrolled into view.
+    //
+    // `program` gets ffmpeg's arguments and must write PPM frames to stdout,
+    // so a script that cats a few .ppm files can stand in for it.
+    //
+    // instance() must first be called from the GUI thread; request() and
+    // cancel() may be called from any thread.
+    class VideoThumbnailer : public QObject {
+        Q_OBJECT
+        QML_ELEMENT
+        QML_SINGLETON
+
+        Q_PROPERTY(QString program READ program WRITE setProgram NOTIFY programChanged)
+        Q_PROPERTY(int maxProcesses READ maxProcesses WRITE setMaxProcesses NOTIFY maxProcessesChanged)
+        Q_PROPERTY(int timeout READ timeout WRITE setTimeout NOTIFY timeoutChanged)
+
+    public:
+        enum class Priority {
+            Low, // prefetching
+            High // on screen
+        };
+
+        // Receives the chosen frame (null if none), or canceled once cancel()ed
+        using Callback = std::function<void(const QImage& frame, bool canceled)>;
+
+        static VideoThumbnailer* instance();
+        static VideoThumbnailer* create(QQmlEngine* qmlEngine, QJSEngine* jsEngine);
+
+        // Queues a frame of at most size pixels for the video. callback is run
+        // exactly once, on context's thread, unless context is destroyed
+        // first. Returns an ID for cancel().
+        quint64 request(const QString& path, int size, Priority priority, QObject* context, Callback callback);
+        void cancel(quint64 id);
+
+        [[nodiscard]] QString program() const;
+        void setProgram(const QString& program);
+
+        [[nodiscard]] int maxProcesses() const;
+        void setMaxProcesses(int maxProcesses);
+
+        [[nodiscard]] int timeout() const;
+        void setTimeout(int timeout);
+
+    signals:
+        void programChanged();
+        void maxProcessesChanged();
+        void timeoutChanged();
+
+    private:
+        explicit VideoThumbnailer(QObject* parent = nullptr);
+
+        struct Waiter {
+            quint64 id;
+            QPointer<QObject> context;
+            Callback callback;
+        };
+
+        struct Job {
+            QString path;
+            int size = 0;
+            Priority priority = Priority::Low;
+            quint64 sequence = 0; // of the latest request, for LIFO order
+            QList<Waiter> waiters;
+
+            bool started = false;
+            QProcess* process = nullptr;
+            QByteArray buffer; // stdout not yet parsed into frames
+            QImage best;
+            double bestScore = -1.0;
+        };
+
+        QString m_program;
+        int m_maxProcesses;
+        int m_timeout;
+
+        QHash<QString, Job*> m_jobs; // by video path
+        int m_running;
+        quint64 m_sequence;
+        std::atomic<quint64> m_nextId;
+
+        void enqueue(quint64 id, const QString& path, int size, Priority priority, QObject* context, Callback callback);
+        void dequeue(quint64 id);
+        void schedule();
+        void start(Job* job);
+        void finish(Job* job, const QImage& frame);
+
+        static void reply(const Waiter& waiter, const QImage& frame, bool canceled);
+    };
+
+} // namespace quicksearch::models
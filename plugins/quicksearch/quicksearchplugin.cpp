@@ -0,0 +1,38 @@
+#include <QQmlEngine>
+#include <QQmlEngineExtensionPlugin>
+
+#include "models/thumbnailcache.hpp"
+#include "models/thumbnailprovider.hpp"
+#include "models/videothumbnailer.hpp"
+
+void qml_register_types_QuickSearch();
+
+// Registers the module's types like the generated plugin would, and installs
+// the image providers on every engine that imports QuickSearch.
+class QuickSearchPlugin : public QQmlEngineExtensionPlugin {
+    Q_OBJECT
+    Q_PLUGIN_METADATA(IID QQmlEngineExtensionInterface_iid)
+
+public:
+    explicit QuickSearchPlugin(QObject* parent = nullptr)
+    : QQmlEngineExtensionPlugin(parent) {
+        // Keeps the linker from dropping the type registrations
+        volatile auto registration = &qml_register_types_QuickSearch;
+        Q_UNUSED(registration);
+    }
+
+    void initializeEngine(QQmlEngine* engine, const char* uri) override {
+        Q_UNUSED(uri);
+
+        // Created here so they live on the GUI thread; workers use them next
+        quicksearch::models::ThumbnailCache::instance();
+        quicksearch::models::VideoThumbnailer::instance();
+
+        if (!engine->imageProvider(quicksearch::models::ThumbnailProvider::Id)) {
+            engine->addImageProvider(quicksearch::models::ThumbnailProvider::Id,
+                                     new quicksearch::models::ThumbnailProvider);
+        }
+    }
+};
+
+#include "quicksearchplugin.moc"
@@ -1,5 +1,7 @@
 import QtQuick
 import Quickshell
+import Quickshell.Wayland
+import QuickSearch
 import qs
 import qs.modules
 import qs.modules.taskbar
@@ -7,6 +9,19 @@ import qs.modules.menubar
 import qs.modules.wallpaper
 
 ShellRoot {
+    // Lets the launcher measure time to first window per app
+    Variants {
+        model: ToplevelManager.toplevels.values
+
+        QtObject {
+            required property var modelData
+            property string appId: modelData.appId
+
+            onAppIdChanged: Launcher.windowOpened(appId)
+            Component.onCompleted: Launcher.windowOpened(appId)
+        }
+    }
+
     Variants {
         model: Quickshell.screens
 